@@ -17,7 +17,7 @@ void AbstractPlot::paintEvent(QPaintEvent *event) {
   QCustomPlot::paintEvent(event);
 
   // Sanity checks
-  if (!mZoomRectActive) {
+  if (!mZoomRectActive && !mRegionRectActive) {
     return;
   }
 
@@ -129,6 +129,17 @@ void AbstractPlot::mousePressEvent(QMouseEvent *event) {
     // fmt::print("mousePressEvent: {} {}\n", mPoint0->x(), mPoint0->y());
   }
 
+  // Initiate a region rectangle if
+  //
+  //   - Left mouse and Shift or Alt keyboard modifier is pressed
+  else if (leftMouse && (event->modifiers() == Qt::ShiftModifier ||
+                         event->modifiers() == Qt::AltModifier)) {
+    mRegionRectActive = true;
+    mRegionModifiers = event->modifiers();
+    mPoint0 = event->position().toPoint();
+    mPoint1 = mPoint0;
+  }
+
   // ... otherwise, we let the base class handle the event
   else {
     QCustomPlot::mousePressEvent(event);
@@ -137,7 +148,7 @@ void AbstractPlot::mousePressEvent(QMouseEvent *event) {
 
 void AbstractPlot::mouseMoveEvent(QMouseEvent *event) {
   // Call base class if zoom rect is NOT active
-  if (!mZoomRectActive) {
+  if (!mZoomRectActive && !mRegionRectActive) {
     QCustomPlot::mouseMoveEvent(event);
 
     return;
@@ -149,6 +160,22 @@ void AbstractPlot::mouseMoveEvent(QMouseEvent *event) {
 }
 
 void AbstractPlot::mouseReleaseEvent(QMouseEvent *event) {
+  // Report a selected region in physical space
+  if (mRegionRectActive && mPoint0 && mPoint1) {
+    QPointF p0(xAxis->pixelToCoord(mPoint0->x()),
+               yAxis->pixelToCoord(mPoint0->y()));
+    QPointF p1(xAxis->pixelToCoord(mPoint1->x()),
+               yAxis->pixelToCoord(mPoint1->y()));
+
+    mRegionRectActive = false;
+    mPoint0 = std::nullopt;
+    mPoint1 = std::nullopt;
+    update();
+
+    regionSelected(QRectF(p0, p1).normalized(), mRegionModifiers);
+    return;
+  }
+
   // Call base class if zoom rect is NOT active
   if (!mZoomRectActive || !mPoint0 || !mPoint1) {
     QCustomPlot::mouseReleaseEvent(event);
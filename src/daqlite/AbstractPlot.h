@@ -27,6 +27,10 @@ public:
 
   virtual void plotDetectorImage(bool Force) = 0;
 
+  /// \brief apply (possibly toggled) config settings such as gradient and
+  /// log scale, without touching the histogram data
+  virtual void setCustomParameters() = 0;
+
 protected:
   // AbstractPlot is abstract and can ONLY be instantiated from a derived class
   AbstractPlot(PlotType Type, ESSConsumer &Consumer)
@@ -64,9 +68,21 @@ protected:
   /// \param event Mouse event
   void mouseReleaseEvent(QMouseEvent *event) override;
 
+  /// \brief A region was selected with Shift or Alt + click or drag
+  /// \param Region    Selected rectangle in plot coordinates, zero size for
+  ///                  a click. Ignored unless overridden
+  /// \param Modifiers Keyboard modifiers held when the selection started
+  virtual void regionSelected(const QRectF &, Qt::KeyboardModifiers) {}
+
   /// Zoom rectangle vars
   bool mZoomRectActive{false};
 
+  /// \brief Rectangle selects a region instead of zooming
+  bool mRegionRectActive{false};
+
+  /// \brief Keyboard modifiers of the region selection
+  Qt::KeyboardModifiers mRegionModifiers;
+
   /// \brief First zoom rectangle corner
   std::optional<QPointF> mPoint0;
 
@@ -1,34 +1,290 @@
-// Copyright (C) 2022 European Spallation Source, ERIC. See LICENSE file
+// Copyright (C) 2022 - 2026 European Spallation Source, ERIC. See LICENSE file
 //===----------------------------------------------------------------------===//
 ///
 /// \file Binner.h
 ///
 /// \brief Binning of data, conversion between values and bins
 /// Main use is for TOF binning
+///
+/// Three modes are supported, all finding a bin in constant time:
+///
+/// - linear: Value * (Bins - 1) / MaxValue, values above MaxValue go into
+///   the last bin
+/// - log: Bins logarithmically spaced bins from MinValue to MaxValue. The
+///   logarithm is taken from the float exponent bits plus a mantissa lookup
+///   table, then corrected against the exact bin edges
+/// - edges: arbitrary increasing bin edges, found with a two level table.
+///   A uniform coarse table has a few cells per bin. Coarse cells holding
+///   more than one edge have a uniform fine table, whose cells are no wider
+///   than the closest edges in the coarse cell, so at most one edge is
+///   compared. The fine cells of a coarse cell are limited to 64 per edge
+///   in it: only if its bin widths differ by more than that are several
+///   edges compared, at worst all edges of the coarse cell
+///
+/// Values below the first edge go into the first bin and values above the
+/// last edge into the last bin, like for the linear mode.
 //===----------------------------------------------------------------------===//
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
 class Binner {
 public:
-  Binner(int bins, int maxvalue) :
-    Bins(bins), MaxValue(maxvalue);
+  enum Mode { Linear, Log, Edges };
+
+  /// \brief mode from its configuration name ("linear", "log", "edges")
+  static Mode mode(const std::string &Name) {
+    std::string Lower = Name;
+    std::transform(Lower.begin(), Lower.end(), Lower.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+
+    if (Lower == "linear") {
+      return Linear;
+    } else if (Lower == "log") {
+      return Log;
+    } else if (Lower == "edges") {
+      return Edges;
+    }
+    throw std::invalid_argument("Invalid binning mode: " + Name);
+  }
+
+  Binner() = default;
+
+  /// \brief linear bins in [0, MaxValue]
+  static Binner linear(uint32_t Bins, double MaxValue) {
+    Binner B;
+    B.mMode = Linear;
+    B.mBins = std::max<uint32_t>(Bins, 1);
+    B.mMaxValue = MaxValue;
+    return B;
+  }
+
+  /// \brief logarithmic bins in [MinValue, MaxValue]
+  static Binner logarithmic(uint32_t Bins, double MinValue, double MaxValue) {
+    if (not(MinValue > 0 and MaxValue > MinValue)) {
+      throw std::invalid_argument("Log binning needs 0 < min_value < max_value");
+    }
+
+    Binner B;
+    B.mMode = Log;
+    B.mBins = std::max<uint32_t>(Bins, 1);
+    B.mMaxValue = MaxValue;
+    B.mLog2Min = std::log2(MinValue);
+    B.mBinsPerLog2 = B.mBins / (std::log2(MaxValue) - B.mLog2Min);
+
+    B.mEdges.resize(B.mBins + 1);
+    for (uint32_t i = 0; i <= B.mBins; i++) {
+      B.mEdges[i] = std::exp2(B.mLog2Min + i / B.mBinsPerLog2);
+    }
+    return B;
+  }
+
+  /// \brief bins between increasing edges, one more edge than bins
+  static Binner edges(std::vector<double> Edges) {
+    if (Edges.size() < 2 or not std::is_sorted(Edges.begin(), Edges.end())) {
+      throw std::invalid_argument("Bin edges must be at least two increasing values");
+    }
+
+    Binner B;
+    B.mMode = Binner::Edges;
+    B.mBins = Edges.size() - 1;
+    B.mMaxValue = Edges.back();
+    B.mEdges = std::move(Edges);
+
+    // Coarse table, a few cells per bin: bin at the start of every cell
+    const double First = B.mEdges.front();
+    const size_t Cells = std::max<size_t>(4 * B.mBins, 64);
+    const double Width = (B.mEdges.back() - First) / Cells;
+    B.mCellsPerValue = Cells / (B.mEdges.back() - First);
+    B.mCoarse.resize(Cells + 1);
+    for (size_t c = 0; c <= Cells; c++) {
+      const double Start = First + c * Width;
+      Cell &Coarse = B.mCoarse[c];
+      Coarse.Bin = B.binAt(Start);
+
+      // Edges inside the cell, a scan from its first bin passes all of them
+      auto Inside = std::upper_bound(B.mEdges.begin(), B.mEdges.end(), Start);
+      auto End = std::lower_bound(Inside, B.mEdges.end(), Start + Width);
+      const size_t Edges = End - Inside;
+      if (c == Cells or Edges < 2) {
+        continue;
+      }
+
+      // Fine cells no wider than the closest edges, within limits
+      double Closest = Width;
+      for (auto Edge = Inside + 1; Edge != End; ++Edge) {
+        Closest = std::min(Closest, *Edge - *(Edge - 1));
+      }
+      const double Needed = std::ceil(Width / Closest);
+      Coarse.Fine = B.mFine.size();
+      Coarse.FineCells = uint32_t(std::min(Needed, 64.0 * Edges));
+      for (size_t f = 0; f < Coarse.FineCells; f++) {
+        B.mFine.push_back(B.binAt(Start + f * Width / Coarse.FineCells));
+      }
+    }
+    return B;
+  }
+
+  /// \brief Binner as configured
+  /// \param Name     "linear", "log" or "edges"
+  /// \param Edges    Only used (and required) for "edges"
+  static Binner create(const std::string &Name, uint32_t Bins, double MinValue,
+                       double MaxValue, const std::vector<double> &Edges) {
+    switch (mode(Name)) {
+    case Log:
+      return logarithmic(Bins, MinValue, MaxValue);
+    case Binner::Edges:
+      return edges(Edges);
+    default:
+      return linear(Bins, MaxValue);
+    }
+  }
+
+  /// \brief calculate bin number
+  uint32_t valToBin(double Value) const {
+    switch (mMode) {
+    case Log:
+      return logBin(Value);
+    case Edges:
+      return edgeBin(Value);
+    default:
+      if (mMaxValue <= 0) {
+        return 0;
+      }
+      return uint32_t(std::clamp(Value, 0.0, mMaxValue) * (mBins - 1) / mMaxValue);
+    }
+  }
 
-  /// \brief calculate bin number:
-  /// 1) Divide by MaxScaledValue to get values in range 0 - 1
-  /// 2) Multiply by number of Bins to get binsin range 0 - (Bins -1)
-  int valToBin(uint32_t Value) {
-    return std::min((Value * (Bins - 1))/(Scale * MaxValue), Bins);
+  /// \brief lower edge of a bin
+  double binToVal(uint32_t Bin) const {
+    if (mMode == Linear) {
+      return (mBins > 1) ? Bin * mMaxValue / (mBins - 1) : 0.0;
+    }
+    return mEdges[std::min(Bin, mBins)];
   }
 
-  /// \brief calculate value:
-  /// 1) Divide by (Bins - 1) to get values from 0 - 1
-  /// 2) Multiply by MaxScaledValue to get values from 0 - MaxValue
-  uint32_t binToVal(int Bin) {
-    return std::max((Bin * MaxValue) / (Bins - 1), MaxValue);
+  /// \brief center of a bin, halfway between its edges. The last linear
+  /// bin only holds MaxValue (and above), its center is MaxValue
+  double binCenter(uint32_t Bin) const {
+    if (mMode == Linear) {
+      return (mBins > 1)
+                 ? std::min((Bin + 0.5) * mMaxValue / (mBins - 1), mMaxValue)
+                 : 0.0;
+    }
+    Bin = std::min(Bin, mBins - 1);
+    return (mEdges[Bin] + mEdges[Bin + 1]) / 2;
   }
 
+  Mode mode() const { return mMode; }
+  uint32_t bins() const { return mBins; }
+  double maxValue() const { return mMaxValue; }
+
 private:
-  int Bins;
-  int MaxValue;
+  static constexpr int MantissaBits{10};
+
+  /// \brief log2(1 + m) at the center of each of the mantissa intervals
+  static const std::array<float, 1 << MantissaBits> &mantissaLog2() {
+    static const auto Table = []() {
+      std::array<float, 1 << MantissaBits> Logs;
+      for (size_t m = 0; m < Logs.size(); m++) {
+        Logs[m] = std::log2(1.0 + (m + 0.5) / Logs.size());
+      }
+      return Logs;
+    }();
+    return Table;
+  }
+
+  /// \brief approximate log2 from the float exponent and mantissa bits
+  static float fastLog2(float Value) {
+    uint32_t Bits;
+    std::memcpy(&Bits, &Value, sizeof(Bits));
+    int Exponent = int((Bits >> 23) & 0xff) - 127;
+    uint32_t Mantissa = (Bits >> (23 - MantissaBits)) & ((1 << MantissaBits) - 1);
+    return Exponent + mantissaLog2()[Mantissa];
+  }
+
+  uint32_t logBin(double Value) const {
+    if (not(Value > mEdges.front())) {
+      return 0;
+    }
+    if (Value >= mEdges.back()) {
+      return mBins - 1;
+    }
+
+    // The approximation is off by less than a bin, fix it with the edges
+    double Guess = (fastLog2(float(Value)) - mLog2Min) * mBinsPerLog2;
+    uint32_t Bin = uint32_t(std::clamp(Guess, 0.0, double(mBins - 1)));
+    while (Bin > 0 and Value < mEdges[Bin]) {
+      Bin--;
+    }
+    while (Bin + 1 < mBins and Value >= mEdges[Bin + 1]) {
+      Bin++;
+    }
+    return Bin;
+  }
+
+  uint32_t edgeBin(double Value) const {
+    if (not(Value > mEdges.front())) {
+      return 0;
+    }
+    if (Value >= mEdges.back()) {
+      return mBins - 1;
+    }
+
+    const double Position = (Value - mEdges.front()) * mCellsPerValue;
+    const size_t c = size_t(Position);
+    const Cell &Coarse = mCoarse[c];
+    uint32_t Bin = Coarse.Bin;
+    if (Coarse.FineCells != 0) {
+      const size_t f = size_t((Position - c) * Coarse.FineCells);
+      Bin = mFine[Coarse.Fine + std::min<size_t>(f, Coarse.FineCells - 1)];
+    }
+
+    // Rounding at the cell borders can be off by one edge either way
+    while (Bin > 0 and Value < mEdges[Bin]) {
+      Bin--;
+    }
+    while (Bin + 1 < mBins and Value >= mEdges[Bin + 1]) {
+      Bin++;
+    }
+    return Bin;
+  }
+
+  /// \brief bin holding a value, by binary search of the edges
+  uint32_t binAt(double Value) const {
+    const size_t Above =
+        std::upper_bound(mEdges.begin(), mEdges.end(), Value) - mEdges.begin();
+    return uint32_t(std::clamp<size_t>(Above, 1, mBins) - 1);
+  }
+
+  Mode mMode{Linear};
+  uint32_t mBins{1};
+  double mMaxValue{0};
+
+  /// \brief log mode
+  double mLog2Min{0};
+  double mBinsPerLog2{0};
+
+  /// \brief log and edges mode, mBins + 1 edges
+  std::vector<double> mEdges;
+
+  /// \brief edges mode tables. A coarse cell has the bin at its start and,
+  /// if it holds several edges, the position of its fine cells in mFine
+  struct Cell {
+    uint32_t Bin{0};
+    uint32_t Fine{0};
+    uint32_t FineCells{0};
+  };
+  std::vector<Cell> mCoarse;
+  std::vector<uint32_t> mFine;
+  double mCellsPerValue{0};
 };
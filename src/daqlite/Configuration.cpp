@@ -6,13 +6,17 @@
 //===----------------------------------------------------------------------===//
 
 #include <Configuration.h>
+#include <PixelTofCube.h>
 
 #include <nlohmann/json.hpp>
 
 #include <fmt/format.h>
+#include <fmt/ranges.h>
+#include <algorithm>
 #include <fstream>
 #include <initializer_list>
 #include <iostream>
+#include <map>
 #include <stdexcept>
 
 using std::string;
@@ -42,9 +46,9 @@ vector<Configuration> Configuration::getConfigurations(const std::string &Path)
   // ---------------------------------------------------------------------------
   // Common options
   //
-  // Read Kafka, Geometry and TOF options - but no plots
+  // Read Kafka, Geometry, TOF and ROI options - but no plots
   nlohmann::json Common;
-  for (const auto& key: {"kafka", "geometry", "tof"}) {
+  for (const auto& key: {"kafka", "geometry", "tof", "rois"}) {
     if (MainJSON.contains(key)) {
       Common[key] = MainJSON[key];
     }
@@ -52,9 +56,18 @@ vector<Configuration> Configuration::getConfigurations(const std::string &Path)
 
   // Handy utility for adding a plot to a configuration
   auto adder = [](const nlohmann::json &common, const nlohmann::json &plot) {
-    // Copy the common state and add a plot
+    // Copy the common state and add a plot, a plot can have its own geometry
+    // and broker, topic and source
     nlohmann::json state = common;
     state["plot"] = plot;
+    if (plot.contains("geometry")) {
+      state["geometry"] = plot["geometry"];
+    }
+    for (const auto &key : {"broker", "topic", "source"}) {
+      if (plot.contains(key)) {
+        state["kafka"][key] = plot[key];
+      }
+    }
 
     // Initialize and return configuration 
     Configuration conf;
@@ -77,9 +90,75 @@ vector<Configuration> Configuration::getConfigurations(const std::string &Path)
     }
   }
 
+  setViews(Configurations);
   return Configurations;
 }
 
+void Configuration::setViews(vector<Configuration> &Configurations) {
+  // The distinct geometries, sources and topics are views histogrammed by
+  // the one consumer of the broker
+  std::map<std::string, vector<ViewOptions>> BrokerViews;
+  for (const auto &Conf : Configurations) {
+    const auto &G = Conf.mGeometry;
+    const auto &Kafka = Conf.mKafka;
+    auto Same = [&G, &Kafka](const ViewOptions &V) {
+      return V.Geometry.XDim == G.XDim and V.Geometry.YDim == G.YDim and
+             V.Geometry.ZDim == G.ZDim and V.Geometry.Offset == G.Offset and
+             V.Source == Kafka.Source and V.Topic == Kafka.Topic;
+    };
+    auto &Views = BrokerViews[Kafka.Broker];
+    if (std::none_of(Views.begin(), Views.end(), Same)) {
+      Views.push_back({G, Kafka.Source, Kafka.Topic});
+    }
+  }
+
+  // The consumer bins the TOF of all plots of the broker alike. ROIs and
+  // pixel spectra belong to the first plot, the other plots may leave them out
+  std::map<std::string, const Configuration *> FirstConfs;
+  for (const auto &Conf : Configurations) {
+    const Configuration &First =
+        *FirstConfs.emplace(Conf.mKafka.Broker, &Conf).first->second;
+    const auto &T = Conf.mTOF;
+    const auto &FirstT = First.mTOF;
+
+    vector<string> Differ;
+    auto Check = [&Differ](bool Same, const char *Option) {
+      if (not Same) {
+        Differ.push_back(Option);
+      }
+    };
+    Check(T.Scale == FirstT.Scale, "tof scale");
+    Check(T.MaxValue == FirstT.MaxValue, "tof max_value");
+    Check(T.BinSize == FirstT.BinSize, "tof bin_size");
+    Check(T.Binning == FirstT.Binning, "tof binning");
+    Check(T.MinValue == FirstT.MinValue, "tof min_value");
+    Check(T.BinEdges == FirstT.BinEdges, "tof bin_edges");
+    Check(T.Unit == FirstT.Unit, "tof unit");
+    Check(T.UnitMaxValue == FirstT.UnitMaxValue, "tof unit_max_value");
+    Check(T.FlightPathFile == FirstT.FlightPathFile, "tof flight_path_file");
+    Check(not T.PixelSpectra or FirstT.PixelSpectra, "tof pixel_spectra");
+    Check(Conf.mRois.empty() or
+              std::equal(Conf.mRois.begin(), Conf.mRois.end(),
+                         First.mRois.begin(), First.mRois.end(),
+                         [](const auto &A, const auto &B) {
+                           return A.Name == B.Name and A.Polygon == B.Polygon;
+                         }),
+          "rois");
+
+    if (not Differ.empty()) {
+      throw std::runtime_error(fmt::format(
+          "Daqlite config error: plot '{}' differs from plot '{}' on broker {}"
+          " in {}, one consumer histograms both",
+          Conf.mPlot.WindowTitle, First.mPlot.WindowTitle, Conf.mKafka.Broker,
+          fmt::join(Differ, ", ")));
+    }
+  }
+
+  for (auto &Conf : Configurations) {
+    Conf.mViews = BrokerViews[Conf.mKafka.Broker];
+  }
+}
+
 
 void Configuration::fromJsonObj(const nlohmann::json &obj) {
   mJsonObj = obj;
@@ -88,6 +167,7 @@ void Configuration::fromJsonObj(const nlohmann::json &obj) {
   getKafkaConfig();
   getPlotConfig();
   getTOFConfig();
+  getRoiConfig();
   print();
 }
 
@@ -107,6 +187,7 @@ void Configuration::fromJsonFile(const std::string &fname) {
   getKafkaConfig();
   getPlotConfig();
   getTOFConfig();
+  getRoiConfig();
   print();
 }
 
@@ -145,10 +226,25 @@ void Configuration::getPlotConfig() {
   mPlot.ClearPeriodic = getVal("plot", "clear_periodic", mPlot.ClearPeriodic);
   mPlot.ClearEverySeconds =
       getVal("plot", "clear_interval_seconds", mPlot.ClearEverySeconds);
+  mPlot.RollingWindowSeconds =
+      getVal("plot", "rolling_window_seconds", mPlot.RollingWindowSeconds);
+  mPlot.RollingSliceSeconds =
+      getVal("plot", "rolling_slice_seconds", mPlot.RollingSliceSeconds);
+  mPlot.HalfLifeSeconds =
+      getVal("plot", "half_life_seconds", mPlot.HalfLifeSeconds);
   mPlot.Interpolate = getVal("plot", "interpolate_pixels", mPlot.Interpolate);
   mPlot.ColorGradient = getVal("plot", "color_gradient", mPlot.ColorGradient);
   mPlot.InvertGradient = getVal("plot", "invert_gradient", mPlot.InvertGradient);
   mPlot.LogScale = getVal("plot", "log_scale", mPlot.LogScale);
+  mPlot.LodReduction = getVal("plot", "lod_reduction", mPlot.LodReduction);
+  mPlot.NormalizePerPulse =
+      getVal("plot", "normalize_per_pulse", mPlot.NormalizePerPulse);
+  mPlot.RefreshRate = getVal("plot", "refresh_rate_hz", mPlot.RefreshRate);
+  mPlot.RobustScale = getVal("plot", "robust_scale", mPlot.RobustScale);
+  mPlot.ScaleLowPercentile =
+      getVal("plot", "scale_low_percentile", mPlot.ScaleLowPercentile);
+  mPlot.ScaleHighPercentile =
+      getVal("plot", "scale_high_percentile", mPlot.ScaleHighPercentile);
 
   // Window options - all are optional
   mPlot.WindowTitle = getVal("plot", "window_title", mPlot.WindowTitle);
@@ -170,12 +266,78 @@ void Configuration::getTOFConfig() {
   mTOF.BinSize = getVal("tof", "bin_size", mTOF.BinSize);
   mTOF.AutoScaleX = getVal("tof", "auto_scale_x", mTOF.AutoScaleX);
   mTOF.AutoScaleY = getVal("tof", "auto_scale_y", mTOF.AutoScaleY);
+  mTOF.Binning = getVal("tof", "binning", mTOF.Binning);
+  mTOF.MinValue = getVal("tof", "min_value", mTOF.MinValue);
+
+  // Arbitrary bin edges also define the number of bins and the range
+  if (mJsonObj.contains("tof") && mJsonObj["tof"].contains("bin_edges")) {
+    mTOF.BinEdges = mJsonObj["tof"]["bin_edges"].get<vector<double>>();
+    if (mTOF.BinEdges.size() < 2) {
+      throw std::runtime_error("Daqlite config error: tof bin_edges needs 2 values");
+    }
+    mTOF.BinSize = mTOF.BinEdges.size() - 1;
+    mTOF.MaxValue = mTOF.BinEdges.back();
+  }
+
+  mTOF.PixelSpectra = getVal("tof", "pixel_spectra", mTOF.PixelSpectra);
+  if (mTOF.PixelSpectra) {
+    const uint64_t Pixels =
+        uint64_t(mGeometry.XDim) * mGeometry.YDim * mGeometry.ZDim;
+    const uint64_t Bytes = Pixels * mTOF.BinSize * sizeof(uint16_t);
+    if (Bytes > PixelTofCube::MaxBytes) {
+      throw std::runtime_error(fmt::format(
+          "Daqlite config error: tof pixel_spectra for {} pixels x {} bins "
+          "can take {} MB, at most {} MB, reduce bin_size",
+          Pixels, mTOF.BinSize, Bytes >> 20, PixelTofCube::MaxBytes >> 20));
+    }
+  }
+  mTOF.Unit = getVal("tof", "unit", mTOF.Unit);
+  mTOF.UnitMaxValue = getVal("tof", "unit_max_value", mTOF.UnitMaxValue);
+  mTOF.FlightPathFile = getVal("tof", "flight_path_file", mTOF.FlightPathFile);
+}
+
+void Configuration::getRoiConfig() {
+  // ROIs are optional, each is either
+  //   {"name": "...", "rect": [x0, y0, x1, y1]} or
+  //   {"name": "...", "polygon": [[x, y], [x, y], ...]}
+  mRois.clear();
+  if (!mJsonObj.contains("rois")) {
+    return;
+  }
+
+  for (const auto &Item : mJsonObj["rois"]) {
+    std::string Name = Item.value("name", fmt::format("ROI {}", mRois.size()));
+
+    if (Item.contains("rect")) {
+      vector<double> Rect = Item["rect"];
+      if (Rect.size() != 4) {
+        throw std::runtime_error("Daqlite config error: ROI 'rect' needs 4 values");
+      }
+      mRois.push_back(RoiTable::rectangle(Name, Rect[0], Rect[1], Rect[2], Rect[3]));
+    }
+
+    else if (Item.contains("polygon")) {
+      RoiTable::Roi Roi{Name, {}};
+      for (const auto &Vertex : Item["polygon"]) {
+        Roi.Polygon.emplace_back(Vertex.at(0).get<double>(), Vertex.at(1).get<double>());
+      }
+      if (Roi.Polygon.size() < 3) {
+        throw std::runtime_error("Daqlite config error: ROI 'polygon' needs 3 vertices");
+      }
+      mRois.push_back(Roi);
+    }
+
+    else {
+      throw std::runtime_error("Daqlite config error: ROI needs 'rect' or 'polygon'");
+    }
+  }
 }
 
 void Configuration::print() {
   fmt::print("[Kafka]\n");
   fmt::print("  Broker {}\n", mKafka.Broker);
   fmt::print("  Topic {}\n", mKafka.Topic);
+  fmt::print("  Source {}\n", mKafka.Source);
   fmt::print("[Geometry]\n");
   fmt::print("  Dimensions ({}, {}, {})\n", mGeometry.XDim, mGeometry.YDim,
              mGeometry.ZDim);
@@ -185,18 +347,35 @@ void Configuration::print() {
   fmt::print("  Plot type {}\n", mPlot.Plot);
   fmt::print("  Clear periodically {}\n", mPlot.ClearPeriodic);
   fmt::print("  Clear interval (s) {}\n", mPlot.ClearEverySeconds);
+  fmt::print("  Rolling window (s) {} (slice {})\n", mPlot.RollingWindowSeconds,
+             mPlot.RollingSliceSeconds);
+  fmt::print("  Half-life (s) {}\n", mPlot.HalfLifeSeconds);
   fmt::print("  Interpolate image {}\n", mPlot.Interpolate);
   fmt::print("  Color gradient {}\n", mPlot.ColorGradient);
   fmt::print("  Invert gradient {}\n", mPlot.InvertGradient);
   fmt::print("  Log Scale {}\n", mPlot.LogScale);
+  fmt::print("  LOD reduction {}\n", mPlot.LodReduction);
+  fmt::print("  Normalize per pulse {}\n", mPlot.NormalizePerPulse);
+  fmt::print("  Refresh rate (Hz) {}\n", mPlot.RefreshRate);
+  fmt::print("  Robust scale {} ({} - {} percentile)\n", mPlot.RobustScale,
+             mPlot.ScaleLowPercentile, mPlot.ScaleHighPercentile);
   fmt::print("  PlotTitle {}\n", mPlot.PlotTitle);
   fmt::print("  X Axis {}\n", mPlot.XAxis);
   fmt::print("[TOF]\n");
   fmt::print("  Scale {}\n", mTOF.Scale);
   fmt::print("  Max value {}\n", mTOF.MaxValue);
   fmt::print("  Bin size {}\n", mTOF.BinSize);
+  fmt::print("  Binning {} (min value {}, {} edges)\n", mTOF.Binning,
+             mTOF.MinValue, mTOF.BinEdges.size());
   fmt::print("  Auto scale x {}\n", mTOF.AutoScaleX);
   fmt::print("  Auto scale y {}\n", mTOF.AutoScaleY);
+  fmt::print("  Pixel spectra {}\n", mTOF.PixelSpectra);
+  fmt::print("  Unit {} (max value {})\n", mTOF.Unit, mTOF.UnitMaxValue);
+  fmt::print("  Flight path file {}\n", mTOF.FlightPathFile);
+  fmt::print("[ROIs]\n");
+  for (auto &Roi : mRois) {
+    fmt::print("  {} ({} vertices)\n", Roi.Name, Roi.Polygon.size());
+  }
 }
 
 //\brief getVal() template is used to effectively achieve
@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <RoiTable.h>
 #include <types/PlotType.h>
 
 #include <nlohmann/json.hpp>
@@ -34,6 +35,14 @@ public:
   /// \brief loads configuration from JSON file
   static std::vector<Configuration> getConfigurations(const std::string &path);
 
+  /// \brief set the views of the configurations, the distinct geometries,
+  /// sources and topics of the plots using the same broker
+  ///
+  /// The one consumer of a broker bins the TOF, and keeps the ROIs and the
+  /// per pixel spectra of its first plot, so throws if another plot of the
+  /// broker has different TOF binning, or other ROIs or pixel spectra
+  static void setViews(std::vector<Configuration> &Configurations);
+
   static void prettyJSON(nlohmann::json &obj, const std::string &header="", int indent=4);
 
   // get the Kafka related config options
@@ -48,6 +57,9 @@ public:
   // get the TOF related config options
   void getTOFConfig();
 
+  // get the regions of interest, if any
+  void getRoiConfig();
+
   /// \brief prints the settings
   void print();
 
@@ -64,6 +76,13 @@ public:
     unsigned int BinSize{512};    // bins
     bool AutoScaleX{true};
     bool AutoScaleY{true};
+    std::string Binning{"linear"}; // "log" and "edges" are also possible
+    double MinValue{1.0};         // us, lower end of log binning
+    std::vector<double> BinEdges; // us, for "edges" binning
+    bool PixelSpectra{false};     // Keep a TOF spectrum per pixel
+    std::string Unit{"tof"};      // "wavelength" and "dspacing" are also possible
+    double UnitMaxValue{10.0};    // A, upper end of converted spectra
+    std::string FlightPathFile{""}; // L1 + L2 and 2 theta per pixel
   };
 
   struct GeometryOptions {
@@ -73,6 +92,14 @@ public:
     int Offset{0};
   };
 
+  /// \brief a geometry histogrammed by the consumer, for the messages of one
+  /// topic and optionally of one source only
+  struct ViewOptions {
+    GeometryOptions Geometry;
+    std::string Source{""};
+    std::string Topic{""};
+  };
+
   struct KafkaOptions {
     std::string Topic{"nmx_detector"};
     std::string Broker{"172.17.5.38:9092"};
@@ -88,13 +115,22 @@ public:
     PlotType Plot{PlotType::PIXELS}; // "tof" and "tof2d" are also possible
     bool ClearPeriodic{false};
     uint32_t ClearEverySeconds{5};
+    double RollingWindowSeconds{0.0}; // Show the last seconds only, 0 is off
+    double RollingSliceSeconds{1.0};  // Time resolution of the window
+    double HalfLifeSeconds{0.0};      // Fade out old counts, 0 is off
     bool Interpolate{false};
     std::string ColorGradient{"hot"};
     bool InvertGradient{false};
     bool LogScale{false};
+    double RefreshRate{0.0};    // Hz, 0 selects the plot type default
+    bool RobustScale{false};    // Scale to percentiles instead of min/max
+    double ScaleLowPercentile{1.0};
+    double ScaleHighPercentile{99.0};
     std::string WindowTitle{"Daquiri Lite - Daqlite"};
     std::string PlotTitle{""};
     std::string XAxis{""};
+    std::string LodReduction{"max"}; // "max" or "sum" for zoomed out images
+    bool NormalizePerPulse{false}; // TOF counts divided by number of pulses
 
     int Width{600};             // Default window width
     int Height{400};            // Default window height
@@ -103,9 +139,17 @@ public:
 
   struct TOFOptions mTOF;
   struct GeometryOptions mGeometry;
+
+  /// \brief distinct geometries, sources and topics of all plots of the
+  /// configuration file with the same broker, the first one is the primary
+  /// view. Empty if only a single file was loaded
+  std::vector<ViewOptions> mViews;
   struct KafkaOptions mKafka;
   struct PlotOptions mPlot;
 
+  /// \brief regions of interest with a live TOF histogram each
+  std::vector<RoiTable::Roi> mRois;
+
   std::string mKafkaConfigFile{""};
   std::vector<std::pair<std::string, std::string>> mKafkaConfig;
 
@@ -0,0 +1,123 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file ConsumerStats.h
+///
+/// \brief Statistics counters of the consumer, and rates derived from them
+///
+/// The counters are monotonic and never reset. They are written by the
+/// worker thread only and can be read by any number of other threads without
+/// locking. Each counter is an atomic on its own cache line, so readers never
+/// cause false sharing with the counters the worker is updating.
+///
+/// Rates are computed by each reader with a RateEstimator, from the counter
+/// differences over a sliding time window.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+class ConsumerStats {
+public:
+  enum Counter {
+    MessagesRx,        ///< All consume() results, including timeouts
+    MessagesData,      ///< Messages with payload
+    MessagesTimeout,   ///< consume() timed out
+    MessagesEof,       ///< End of partition reached
+    MessagesUnknown,   ///< Unknown topic or partition
+    MessagesOther,     ///< Other consume errors
+    VerifyFailures,    ///< Payload is no ev42, ev44 or da00 flatbuffer
+    SourceFiltered,    ///< Messages of other sources than configured
+    Bytes,             ///< Payload bytes of data messages
+    Events,            ///< Events (or da00 arrays) received
+    EventsAccepted,    ///< Events added to the histograms
+    DiscardPixel,      ///< Events with pixel ids outside the geometry
+    DiscardMalformed,  ///< Messages with inconsistent array sizes
+    DiscardTofRange,   ///< da00 arrays with bins beyond the TOF range
+    Counters
+  };
+
+  /// \brief Counter name for printing
+  static const char *name(Counter C) {
+    static constexpr const char *Names[Counters] = {
+        "messages_rx",     "messages_data",     "messages_timeout",
+        "messages_eof",    "messages_unknown",  "messages_other",
+        "verify_failures", "source_filtered",   "bytes",
+        "events",          "events_accepted",   "discard_pixel",
+        "discard_malformed", "discard_tof_range"};
+    return Names[C];
+  }
+
+  using Snapshot = std::array<uint64_t, Counters>;
+
+  /// \brief Add to a counter, from the (single) writer thread only
+  void add(Counter C, uint64_t N = 1) {
+    // No read-modify-write instruction is needed with a single writer
+    auto &Value = mCounters[C].Value;
+    Value.store(Value.load(std::memory_order_relaxed) + N,
+                std::memory_order_relaxed);
+  }
+
+  uint64_t get(Counter C) const {
+    return mCounters[C].Value.load(std::memory_order_relaxed);
+  }
+
+  /// \brief All counters at (about) the same time
+  Snapshot snapshot() const {
+    Snapshot Values;
+    for (size_t i = 0; i < Counters; i++) {
+      Values[i] = mCounters[i].Value.load(std::memory_order_relaxed);
+    }
+    return Values;
+  }
+
+private:
+  struct alignas(64) Padded {
+    std::atomic<uint64_t> Value{0};
+  };
+
+  std::array<Padded, Counters> mCounters;
+};
+
+/// \brief Counter rates over a sliding time window, one estimator per reader
+class RateEstimator {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit RateEstimator(double WindowSeconds = 5.0)
+      : mWindow(std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(WindowSeconds))) {}
+
+  /// \brief Add a sample of the counters
+  void update(const ConsumerStats &Stats, Clock::time_point Now = Clock::now()) {
+    mSamples.emplace_back(Now, Stats.snapshot());
+
+    // Keep one sample older than the window as the reference
+    while (mSamples.size() > 2 and Now - mSamples[1].first >= mWindow) {
+      mSamples.pop_front();
+    }
+  }
+
+  /// \brief Counts per second of a counter over the window, 0 until two
+  /// samples have been taken
+  double rate(ConsumerStats::Counter C) const {
+    if (mSamples.size() < 2) {
+      return 0.0;
+    }
+    const auto &[T0, V0] = mSamples.front();
+    const auto &[T1, V1] = mSamples.back();
+    double Seconds = std::chrono::duration<double>(T1 - T0).count();
+    return (Seconds > 0) ? (V1[C] - V0[C]) / Seconds : 0.0;
+  }
+
+private:
+  Clock::duration mWindow;
+  std::deque<std::pair<Clock::time_point, ConsumerStats::Snapshot>> mSamples;
+};
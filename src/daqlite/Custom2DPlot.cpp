@@ -8,6 +8,7 @@
 #include <Custom2DPlot.h>
 
 #include <AbstractPlot.h>
+#include <Binner.h>
 #include <Configuration.h>
 #include <ESSConsumer.h>
 #include <types/PlotType.h>
@@ -16,16 +17,46 @@
 
 #include <fmt/format.h>
 #include <algorithm>
+#include <cmath>
 #include <ratio>
 #include <string>
 
 using std::string;
 using std::vector;
 
+namespace {
+/// \brief Color scale ticks and labels in displayed counts, while the color
+/// map holds the weighted counts of a fading image in units of 1 / Unit
+class DecayTicker : public QCPAxisTicker {
+public:
+  DecayTicker(const DecayScale &Decay, double Unit)
+      : mDecay(Decay), mUnit(Unit) {}
+
+protected:
+  double getTickStep(const QCPRange &Range) override {
+    const double Scale = mDecay.scale() / mUnit;
+    return QCPAxisTicker::getTickStep(
+               QCPRange(Range.lower * Scale, Range.upper * Scale)) / Scale;
+  }
+
+  QString getTickLabel(double Tick, const QLocale &Locale, QChar FormatChar,
+                       int Precision) override {
+    return QCPAxisTicker::getTickLabel(Tick * mDecay.scale() / mUnit, Locale,
+                                       FormatChar, Precision);
+  }
+
+private:
+  const DecayScale &mDecay;
+  double mUnit;
+};
+} // namespace
+
 Custom2DPlot::Custom2DPlot(Configuration &Config, ESSConsumer &Consumer,
                            Projection Proj)
     : AbstractPlot(PlotType::PIXELS, Consumer)
     , mConfig(Config)
+    , mView(Consumer.viewIndex(Config))
+    , mCursor(Consumer.histogram().subscribe())
     , mProjection(Proj) {
   // Register callback functions for events
   connect(this, &QCustomPlot::mouseMove, this, &Custom2DPlot::showPointToolTip);
@@ -33,7 +64,6 @@ Custom2DPlot::Custom2DPlot(Configuration &Config, ESSConsumer &Consumer,
 
   auto &geom = mConfig.mGeometry;
   LogicalGeometry = new ESSGeometry(geom.XDim, geom.YDim, geom.ZDim, 1);
-  HistogramData.resize(LogicalGeometry->max_pixel() + 1);
 
   // this will also allow rescaling the color scale by dragging/zooming
   setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
@@ -46,28 +76,27 @@ Custom2DPlot::Custom2DPlot(Configuration &Config, ESSConsumer &Consumer,
   xAxis->setSubTicks(false);
   xAxis->setTickLabelRotation(90);
 
-  mColorMap = new QCPColorMap(xAxis, yAxis);
+  mColorMap = new LutColorMap(xAxis, yAxis);
+
+  // the full resolution image has nx * ny cells, the color map only holds
+  // the cells of the pyramid level currently on screen
+  auto Reduction = LodPyramid<uint64_t>::Max;
+  if (mConfig.mPlot.LodReduction == "sum") {
+    Reduction = LodPyramid<uint64_t>::Sum;
+  }
 
-  // we want the color map to have nx * ny data points
   if (mProjection == ProjectionXY) {
     xAxis->setLabel("X");
     yAxis->setLabel("Y");
-    mColorMap->data()->setSize(geom.XDim, geom.YDim);
-    mColorMap->data()->setRange(QCPRange(0, geom.XDim - 1),
-                                QCPRange(0, geom.YDim - 1)); //
+    mImage.resize(geom.XDim, geom.YDim, Reduction);
   } else if (mProjection == ProjectionXZ) {
     xAxis->setLabel("X");
     yAxis->setLabel("Z");
-    mColorMap->data()->setSize(geom.XDim, geom.ZDim);
-    mColorMap->data()->setRange(QCPRange(0, geom.XDim - 1),
-                                QCPRange(0, geom.ZDim - 1));
+    mImage.resize(geom.XDim, geom.ZDim, Reduction);
   } else {
     xAxis->setLabel("Y");
     yAxis->setLabel("Z");
-    mColorMap->data()->setSize(geom.YDim, geom.ZDim);
-
-    mColorMap->data()->setRange(QCPRange(0, geom.YDim - 1),
-                                QCPRange(0, geom.ZDim - 1));
+    mImage.resize(geom.YDim, geom.ZDim, Reduction);
   }
   // add a color scale:
   mColorScale = new QCPColorScale(this);
@@ -93,8 +122,28 @@ Custom2DPlot::Custom2DPlot(Configuration &Config, ESSConsumer &Consumer,
   axisRect()->setMarginGroup(QCP::msBottom | QCP::msTop, marginGroup);
   mColorScale->setMarginGroup(QCP::msBottom | QCP::msTop, marginGroup);
 
-  // rescale the key (x) and value (y) axes so the whole color map is visible:
-  rescaleAxes();
+  // show the whole image, cell indexes and coordinates match
+  xAxis->setRange(-0.5, mImage.width(0) - 0.5);
+  yAxis->setRange(-0.5, mImage.height(0) - 0.5);
+  updateVisibleCells();
+
+  // zooming, dragging and the zoom rectangle may change the level of detail
+  auto RangeChanged = QOverload<const QCPRange &>::of(&QCPAxis::rangeChanged);
+  connect(xAxis, RangeChanged, this, &Custom2DPlot::handleRangeChanged);
+  connect(yAxis, RangeChanged, this, &Custom2DPlot::handleRangeChanged);
+  connect(this, &QCustomPlot::beforeReplot, this,
+          &Custom2DPlot::updateVisibleCells);
+
+  // Fading replaces the rolling window and periodic clearing
+  mDecay.setup(mConfig.mPlot.HalfLifeSeconds, DecayMaxWeight);
+  if (mDecay.enabled()) {
+    mColorScale->axis()->setTicker(
+        QSharedPointer<DecayTicker>::create(mDecay, DecayUnit));
+  } else {
+    mWindow.setup(size_t(geom.XDim) * geom.YDim * geom.ZDim + 1,
+                  mConfig.mPlot.RollingWindowSeconds,
+                  mConfig.mPlot.RollingSliceSeconds);
+  }
 
   t1 = std::chrono::high_resolution_clock::now();
 }
@@ -153,77 +202,364 @@ string Custom2DPlot::getNextColorGradient(const string &GradientName) {
 }
 
 void Custom2DPlot::clearDetectorImage() {
-  std::fill(HistogramData.begin(), HistogramData.end(), 0);
+  mImage.clear();
+  mStats.clear();
+  mWindow.clear();
+  mDecay.setup(mConfig.mPlot.HalfLifeSeconds, DecayMaxWeight);
+  mConsumer.clearPixelSpectra();
   plotDetectorImage(true);
 }
 
-void Custom2DPlot::plotDetectorImage(bool Force) {
+void Custom2DPlot::plotDetectorImage(bool) {
+  // the cells on screen are copied from the image in updateVisibleCells()
+  // which is called just before the plot is redrawn
+  mViewDirty = true;
+  updateRoiCurves();
+  replot();
+}
 
-  setCustomParameters();
+void Custom2DPlot::handleRangeChanged() {
+  mViewDirty = true;
+  replot(QCustomPlot::rpQueuedReplot);
+}
+
+void Custom2DPlot::resizeEvent(QResizeEvent *event) {
+  mViewDirty = true;
+  AbstractPlot::resizeEvent(event);
+}
 
-  // if scales match the dimensions (xdim 400, range 0, 399) then cell indexes
-  // and coordinates match. PixelId 0 does not exist.
-  for (unsigned int i = 1; i < HistogramData.size(); i++) {
-    if ((HistogramData[i] != 0) or (Force)) {
-      auto xIndex = LogicalGeometry->x(i);
-      auto yIndex = LogicalGeometry->y(i);
-      auto zIndex = LogicalGeometry->z(i);
-
-      // here we could
-      // x, y, z = pos(i)
-
-      if (mProjection == ProjectionXY) {
-        // printf("XY: x,y,z %d, %d, %d: count %d\n", xIndex, yIndex, zIndex,
-        // HistogramData[i]);
-        mColorMap->data()->setCell(xIndex, yIndex, HistogramData[i]);
-      } else if (mProjection == ProjectionXZ) {
-        // printf("XZ: x,y,z %d, %d, %d: count %d\n", xIndex, yIndex, zIndex,
-        // HistogramData[i]);
-        mColorMap->data()->setCell(xIndex, zIndex, HistogramData[i]);
-      } else {
-        // printf("YZ: x,y,z %d, %d, %d: count %d\n", xIndex, yIndex, zIndex,
-        // HistogramData[i]);
-        mColorMap->data()->setCell(yIndex, zIndex, HistogramData[i]);
+void Custom2DPlot::updateVisibleCells() {
+  if (not mViewDirty) {
+    return;
+  }
+  mViewDirty = false;
+
+  const int Width = mImage.width(0);
+  const int Height = mImage.height(0);
+
+  // Visible part of the full resolution image in cell indexes
+  const QCPRange XRange = xAxis->range();
+  const QCPRange YRange = yAxis->range();
+  int X0 = std::clamp(int(std::floor(XRange.lower + 0.5)), 0, Width - 1);
+  int X1 = std::clamp(int(std::ceil(XRange.upper - 0.5)), 0, Width - 1);
+  int Y0 = std::clamp(int(std::floor(YRange.lower + 0.5)), 0, Height - 1);
+  int Y1 = std::clamp(int(std::ceil(YRange.upper - 0.5)), 0, Height - 1);
+
+  // Screen pixels covering the visible cells
+  int PixelsX = int((X1 - X0 + 1) * axisRect()->width() / XRange.size());
+  int PixelsY = int((Y1 - Y0 + 1) * axisRect()->height() / YRange.size());
+
+  int Level = mImage.selectLevel(X1 - X0 + 1, Y1 - Y0 + 1, PixelsX, PixelsY);
+  const int Step = 1 << Level;
+  X0 >>= Level;
+  X1 >>= Level;
+  Y0 >>= Level;
+  Y1 >>= Level;
+
+  // A level cell covers Step x Step image cells, place it at their center
+  const double Center = (Step - 1) / 2.0;
+  auto Data = mColorMap->data();
+  Data->setSize(X1 - X0 + 1, Y1 - Y0 + 1);
+  Data->setRange(QCPRange(X0 * Step + Center, X1 * Step + Center),
+                 QCPRange(Y0 * Step + Center, Y1 * Step + Center));
+
+  // The color map reads the visible cells directly from the pyramid level
+  // and converts the integer counts while colorizing
+  const size_t LevelWidth = mImage.width(Level);
+  mColorMap->setCells(mImage.cells(Level), Y0 * LevelWidth + X0, 1,
+                      LevelWidth);
+
+  // Zoomed out sums are not described by the level 0 statistics, but then
+  // the visible cells are few and can be scanned
+  if (Level > 0 and mImage.mode() == LodPyramid<uint64_t>::Sum) {
+    uint64_t Min = mImage.at(Level, X0, Y0);
+    uint64_t Max = Min;
+    for (int y = Y0; y <= Y1; y++) {
+      for (int x = X0; x <= X1; x++) {
+        const uint64_t Value = mImage.at(Level, x, y);
+        Min = std::min(Min, Value);
+        Max = std::max(Max, Value);
       }
     }
+    mColorMap->setDataRange(QCPRange(Min, Max));
+    return;
   }
 
-  // rescale the data dimension (color) such that all data points lie in the
-  // span visualized by the color gradient:
-  mColorMap->rescaleDataRange(true);
+  // rescale the data dimension (color) from the running statistics
+  auto [Min, Max] = mStats.range(size_t(Width) * Height,
+                                 mConfig.mPlot.RobustScale,
+                                 mConfig.mPlot.ScaleLowPercentile,
+                                 mConfig.mPlot.ScaleHighPercentile);
+  mColorMap->setDataRange(QCPRange(Min, Max));
+}
 
-  replot();
+std::pair<int, int> Custom2DPlot::imageCell(unsigned int PixelId) const {
+  if (mProjection == ProjectionXY) {
+    return {LogicalGeometry->x(PixelId), LogicalGeometry->y(PixelId)};
+  } else if (mProjection == ProjectionXZ) {
+    return {LogicalGeometry->x(PixelId), LogicalGeometry->z(PixelId)};
+  }
+  return {LogicalGeometry->y(PixelId), LogicalGeometry->z(PixelId)};
 }
 
 void Custom2DPlot::updateData() {
   auto t2 = std::chrono::high_resolution_clock::now();
   std::chrono::duration<int64_t, std::nano> elapsed = t2 - t1;
 
-  // update histogram data from consumer of worker thread
-  vector<uint32_t> Histogram = mConsumer.readResetHistogram();
+  // histogram deltas published by the worker thread since the last update
+  auto Deltas = mConsumer.histogram().pull(mCursor);
 
+  // Subtract the counts that dropped out of the rolling window, or else
+  // periodically clear the histogram. Fading only changes the weight
+  double Weight = 1.0;
   int64_t nsBetweenClear = 1000000000LL * mConfig.mPlot.ClearEverySeconds;
-  if (mConfig.mPlot.ClearPeriodic and (elapsed.count() >= nsBetweenClear)) {
+  if (mDecay.enabled()) {
+    Weight = mDecay.advance(DecayScale::Clock::now());
+    if (mDecay.needsRenormalize()) {
+      renormalize();
+      Weight = 1.0;
+    }
+  } else if (mWindow.enabled()) {
+    mWindow.advance(RollingWindow<>::Clock::now(),
+                    [this](size_t First, const uint32_t *Counts, size_t Cells) {
+      // The pixels of a block need not be neighbours in the image
+      for (size_t i = 0; i < Cells; i++) {
+        if (Counts[i] == 0) {
+          continue;
+        }
+        auto [x, y] = imageCell(First + i);
+        uint64_t Old = mImage.at(0, x, y);
+        uint64_t New = Old - Counts[i];
+        mImage.set(x, y, New);
+        mStats.update(Old, New);
+      }
+    });
+  } else if (mConfig.mPlot.ClearPeriodic and (elapsed.count() >= nsBetweenClear)) {
     t1 = std::chrono::high_resolution_clock::now();
-    std::fill(HistogramData.begin(), HistogramData.end(), 0);
-    plotDetectorImage(true); // Periodically clear the histogram
-    //
+    mImage.clear(); // Periodically clear the histogram
+    mStats.clear();
   }
 
-  // Accumulate counts, PixelId 0 does not exist
-  for (unsigned int i = 1; i < Histogram.size(); i++) {
-    HistogramData[i] += Histogram[i];
+  // Accumulate the counts of the view into the projected image, which also
+  // updates the zoomed out levels. PixelId 0 does not exist
+  const double Scale = Weight * unit();
+  const auto &View = mConsumer.views()[mView];
+  const size_t Pixels = View.pixels();
+  for (const auto &Delta : Deltas) {
+    if (Delta->size() < View.PixelBase + Pixels + 1) {
+      continue;
+    }
+    // Only the pixels with new counts are visited
+    Delta->forEach(View.PixelBase, Pixels + 1, [&](size_t i, uint32_t Count) {
+      if (i == 0) {
+        return;
+      }
+      if (mWindow.enabled()) {
+        mWindow.add(i, Count);
+      }
+      auto [x, y] = imageCell(i);
+      uint64_t Old = mImage.at(0, x, y);
+      uint64_t New = Old + uint64_t(std::llround(Count * Scale));
+      mImage.set(x, y, New);
+      mStats.update(Old, New);
+    });
   }
-  plotDetectorImage(false);
   return;
 }
 
+void Custom2DPlot::renormalize() {
+  mImage.scale(mDecay.renormalize());
+
+  // The statistics are rebuilt from the scaled cells
+  mStats.clear();
+  for (int y = 0; y < mImage.height(0); y++) {
+    for (int x = 0; x < mImage.width(0); x++) {
+      mStats.update(0, mImage.at(0, x, y));
+    }
+  }
+}
+
+void Custom2DPlot::regionSelected(const QRectF &Region,
+                                  Qt::KeyboardModifiers Modifiers) {
+  // ROIs and pixel spectra are in pixel ids of the primary view
+  if (mView != 0) {
+    return;
+  }
+  if (Modifiers == Qt::AltModifier) {
+    defineRoi(Region);
+  } else {
+    showSpectrum(Region);
+  }
+}
+
+void Custom2DPlot::defineRoi(const QRectF &Region) {
+  // ROIs are defined in (x, y), so only in the XY projection
+  if (mProjection != ProjectionXY) {
+    return;
+  }
+
+  // A click adds a polygon vertex, a drag defines a rectangle
+  if (Region.width() == 0 and Region.height() == 0) {
+    mPendingPolygon.emplace_back(Region.x(), Region.y());
+    updatePendingCurve();
+    replot();
+    return;
+  }
+
+  std::string Name = fmt::format("ROI {}", mConsumer.getRois().size());
+  if (not mConsumer.addRoi(RoiTable::rectangle(Name, Region.left(), Region.top(),
+                                               Region.right(), Region.bottom()))) {
+    fmt::print("Maximum number of ROIs reached\n");
+  }
+  plotDetectorImage(false);
+}
+
+void Custom2DPlot::keyPressEvent(QKeyEvent *event) {
+  const auto Key = event->key();
+
+  // Enter closes the polygon ROI being drawn, Escape discards it
+  if (Key == Qt::Key_Return or Key == Qt::Key_Enter) {
+    if (mPendingPolygon.size() >= 3) {
+      std::string Name = fmt::format("ROI {}", mConsumer.getRois().size());
+      if (not mConsumer.addRoi({Name, mPendingPolygon})) {
+        fmt::print("Maximum number of ROIs reached\n");
+      }
+    }
+    mPendingPolygon.clear();
+    updatePendingCurve();
+    plotDetectorImage(false);
+  } else if (Key == Qt::Key_Escape) {
+    mPendingPolygon.clear();
+    updatePendingCurve();
+    replot();
+  } else {
+    AbstractPlot::keyPressEvent(event);
+  }
+}
+
+void Custom2DPlot::updatePendingCurve() {
+  if (mPendingCurve == nullptr) {
+    mPendingCurve = new QCPCurve(xAxis, yAxis);
+    mPendingCurve->setPen(QPen(Qt::white, 1, Qt::DashLine));
+    mPendingCurve->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssCircle, 4));
+  }
+
+  QVector<double> X, Y;
+  for (auto [x, y] : mPendingPolygon) {
+    X.push_back(x);
+    Y.push_back(y);
+  }
+  mPendingCurve->setData(X, Y);
+}
+
+void Custom2DPlot::updateRoiCurves() {
+  if (mProjection != ProjectionXY or mView != 0) {
+    return;
+  }
+
+  // ROIs are only ever appended
+  auto Rois = mConsumer.getRois();
+  for (size_t i = mRoiCurves.size(); i < Rois.size(); i++) {
+    auto *Curve = new QCPCurve(xAxis, yAxis);
+    Curve->setPen(QPen(Qt::white, 1));
+    Curve->setName(QString::fromStdString(Rois[i].Name));
+
+    QVector<double> X, Y;
+    for (auto [x, y] : Rois[i].Polygon) {
+      X.push_back(x);
+      Y.push_back(y);
+    }
+    // close the outline
+    X.push_back(X.front());
+    Y.push_back(Y.front());
+    Curve->setData(X, Y);
+
+    mRoiCurves.push_back(Curve);
+  }
+}
+
+void Custom2DPlot::showSpectrum(const QRectF &Region) {
+  if (not mConsumer.hasPixelSpectra()) {
+    fmt::print("Pixel TOF spectra are disabled, set tof.pixel_spectra\n");
+    return;
+  }
+
+  // Image cells covered by the region, a click selects a single cell
+  const int X0 = std::max(0, int(std::lround(Region.left())));
+  const int X1 = std::min(mImage.width(0) - 1, int(std::lround(Region.right())));
+  const int Y0 = std::max(0, int(std::lround(Region.top())));
+  const int Y1 = std::min(mImage.height(0) - 1, int(std::lround(Region.bottom())));
+  if (X0 > X1 or Y0 > Y1) {
+    return;
+  }
+
+  // All pixels projected onto the cells
+  auto &geom = mConfig.mGeometry;
+  int Depth = geom.ZDim;
+  if (mProjection == ProjectionXZ) {
+    Depth = geom.YDim;
+  } else if (mProjection == ProjectionYZ) {
+    Depth = geom.XDim;
+  }
+
+  vector<uint32_t> PixelIds;
+  PixelIds.reserve(size_t(X1 - X0 + 1) * (Y1 - Y0 + 1) * Depth);
+  for (int b = Y0; b <= Y1; b++) {
+    for (int a = X0; a <= X1; a++) {
+      for (int c = 0; c < Depth; c++) {
+        if (mProjection == ProjectionXY) {
+          PixelIds.push_back(LogicalGeometry->pixel3D(a, b, c));
+        } else if (mProjection == ProjectionXZ) {
+          PixelIds.push_back(LogicalGeometry->pixel3D(a, c, b));
+        } else {
+          PixelIds.push_back(LogicalGeometry->pixel3D(c, a, b));
+        }
+      }
+    }
+  }
+
+  vector<uint64_t> Spectrum = mConsumer.getPixelSpectrum(PixelIds);
+
+  if (mSpectrumPlot == nullptr) {
+    mSpectrumPlot = new QCustomPlot(this);
+    mSpectrumPlot->setWindowFlags(Qt::Window);
+    mSpectrumPlot->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
+    mSpectrumPlot->addGraph();
+    mSpectrumPlot->graph(0)->setLineStyle(QCPGraph::lsStepCenter);
+    mSpectrumPlot->graph(0)->setBrush(QBrush(QColor(0, 0, 255, 20)));
+    mSpectrumPlot->xAxis->setLabel("TOF (us)");
+    mSpectrumPlot->yAxis->setLabel("Counts");
+    mSpectrumPlot->resize(600, 300);
+  }
+
+  // The spectra are binned as configured, linear, log or by edges
+  auto &tof = mConfig.mTOF;
+  const Binner TofBins = Binner::create(tof.Binning, tof.BinSize, tof.MinValue,
+                                        tof.MaxValue, tof.BinEdges);
+  QVector<QCPGraphData> Points(Spectrum.size());
+  for (size_t i = 0; i < Spectrum.size(); i++) {
+    Points[i].key = TofBins.binCenter(i);
+    Points[i].value = Spectrum[i];
+  }
+  mSpectrumPlot->graph(0)->data()->set(Points, true);
+  mSpectrumPlot->rescaleAxes();
+  mSpectrumPlot->setWindowTitle(QString("TOF spectrum (%1 - %2, %3 - %4)")
+                                    .arg(X0).arg(X1).arg(Y0).arg(Y1));
+  mSpectrumPlot->replot();
+  mSpectrumPlot->show();
+  mSpectrumPlot->raise();
+}
+
 // MouseOver, display coordinate and data in tooltip
 void Custom2DPlot::showPointToolTip(QMouseEvent *event) {
   int x = this->xAxis->pixelToCoord(event->pos().x());
   int y = this->yAxis->pixelToCoord(event->pos().y());
 
-  double count = mColorMap->data()->data(x, y);
+  // always report the full resolution count, whatever level is displayed
+  double count = 0;
+  if (x >= 0 and x < mImage.width(0) and y >= 0 and y < mImage.height(0)) {
+    count = mImage.at(0, x, y) * mDecay.scale() / unit();
+  }
 
   setToolTip(QString("X: %1 , Y: %2, Count: %3").arg(x).arg(y).arg(count));
 }
@@ -9,6 +9,11 @@
 #pragma once
 
 #include <AbstractPlot.h>
+#include <DecayScale.h>
+#include <LodPyramid.h>
+#include <LutColorMap.h>
+#include <RollingWindow.h>
+#include <ValueDistribution.h>
 
 #include <QPlot/qcustomplot/qcustomplot.h>
 
@@ -31,7 +36,7 @@ public:
   /// \brief plot needs the configurable plotting options
   Custom2DPlot(Configuration &Config, ESSConsumer&, Projection Proj);
 
-  /// \brief adds histogram data, clears periodically then calls
+  /// \brief adds histogram data and clears periodically, drawing is left to
   /// plotDetectorImage()
   void updateData() override;
 
@@ -39,7 +44,7 @@ public:
   QCPColorGradient getColorGradient(const std::string &GradientName);
 
   /// \brief update plot based on (possibly dynamic) config settings
-  void setCustomParameters();
+  void setCustomParameters() override;
 
   /// \brief rotate through gradient names
   std::string getNextColorGradient(const std::string &GradientName);
@@ -54,15 +59,98 @@ public:
 public slots:
   void showPointToolTip(QMouseEvent *event);
 
+  /// \brief the visible axis range changed, so the displayed level of detail
+  /// must be reevaluated before next replot
+  void handleRangeChanged();
+
+  /// \brief refill the color map from the pyramid level and sub rectangle
+  /// matching the current axis ranges and widget size
+  void updateVisibleCells();
+
+protected:
+  /// \brief widget size changes may select a different level of detail
+  void resizeEvent(QResizeEvent *event) override;
+
+  /// \brief Shift: show the TOF spectrum of the region, Alt: define a ROI
+  void regionSelected(const QRectF &Region,
+                      Qt::KeyboardModifiers Modifiers) override;
+
+  /// \brief Enter closes and Escape discards a polygon ROI being drawn
+  void keyPressEvent(QKeyEvent *event) override;
+
 private:
+  /// \brief show the summed TOF spectrum of the pixels projected onto the
+  /// selected image cells (requires tof.pixel_spectra)
+  void showSpectrum(const QRectF &Region);
+
+  /// \brief add a rectangle ROI (drag) or a polygon ROI vertex (click)
+  void defineRoi(const QRectF &Region);
+
+  /// \brief draw the outlines of ROIs added since last time
+  void updateRoiCurves();
+
+  /// \brief draw the polygon ROI being defined
+  void updatePendingCurve();
+
+  /// \brief image cell (projected) for a given pixel id
+  std::pair<int, int> imageCell(unsigned int PixelId) const;
+
   // QCustomPlot variables
   QCPColorScale *mColorScale{nullptr};
-  QCPColorMap *mColorMap{nullptr};
+  LutColorMap *mColorMap{nullptr};
 
   /// \brief configuration obtained from main()
   Configuration &mConfig;
 
-  std::vector<uint32_t> HistogramData;
+  /// \brief view of the consumer shown, ROIs and pixel spectra are only
+  /// available for the primary view 0
+  size_t mView{0};
+
+  /// \brief projected detector image (level 0) and its zoomed out levels,
+  /// in counts or, when fading, in weighted counts times DecayUnit
+  LodPyramid<uint64_t> mImage;
+
+  /// \brief position in the pixel histogram deltas of the consumer
+  DeltaBus<uint32_t>::Cursor mCursor;
+
+  /// \brief running distribution of the level 0 image cells
+  ValueDistribution mStats;
+
+  /// \brief counts of the last seconds by pixel id, if showing a rolling
+  /// window instead of clearing periodically
+  RollingWindow<uint32_t> mWindow;
+
+  /// \brief weight of new counts when fading out old ones, the image cells
+  /// hold weighted counts
+  DecayScale mDecay;
+
+  /// \brief weighted counts are stored as integers in units of 1 / 256
+  /// count, the rounding is below 0.2 % of a count
+  static constexpr double DecayUnit{256.0};
+
+  /// \brief renormalize after 16 half-lives, a stored count is then at most
+  /// 2^24 units and cells hold up to 2^40 weighted counts
+  static constexpr double DecayMaxWeight{65536.0};
+
+  /// \brief image cell units per count
+  double unit() const { return mDecay.enabled() ? DecayUnit : 1.0; }
+
+  /// \brief multiply the image by the decay scale and restart the weight
+  void renormalize();
+
+  /// \brief color map must be refilled from mImage before next replot
+  bool mViewDirty{true};
+
+  /// \brief separate window for the TOF spectrum of a selected region,
+  /// created on first selection
+  QCustomPlot *mSpectrumPlot{nullptr};
+
+  /// \brief ROI outlines, in ROI order
+  std::vector<QCPCurve *> mRoiCurves;
+
+  /// \brief vertices of the polygon ROI being defined, and its outline
+  std::vector<std::pair<double, double>> mPendingPolygon;
+  QCPCurve *mPendingCurve{nullptr};
 
   /// \brief for calculating x, y, z from pixelid
   ESSGeometry *LogicalGeometry;
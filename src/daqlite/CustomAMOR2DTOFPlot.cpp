@@ -1,13 +1,14 @@
 // Copyright (C) 2020 - 2025 European Spallation Source, ERIC. See LICENSE file
 //===----------------------------------------------------------------------===//
 ///
-/// \file Custom2DPlot.cpp
+/// \file CustomAMOR2DTOFPlot.cpp
 ///
 //===----------------------------------------------------------------------===//
 
 #include <CustomAMOR2DTOFPlot.h>
 
 #include <AbstractPlot.h>
+#include <Binner.h>
 #include <types/PlotType.h>
 #include <Configuration.h>
 #include <ESSConsumer.h>
@@ -17,8 +18,6 @@
 #include <QEvent>
 
 #include <fmt/format.h>
-#include <string.h>
-#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -27,13 +26,12 @@ using std::vector;
 CustomAMOR2DTOFPlot::CustomAMOR2DTOFPlot(Configuration &Config,
                                          ESSConsumer &Consumer)
     : AbstractPlot(PlotType::TOF2D, Consumer)
-    , mConfig(Config) {
-  if ((not(mConfig.mGeometry.YDim <= TOF2DY) or
-       (not(mConfig.mTOF.BinSize <= TOF2DX)))) {
-    throw(std::runtime_error("2D TOF histogram size mismatch"));
-  }
-
-  memset(HistogramData2D, 0, sizeof(HistogramData2D));
+    , mConfig(Config)
+    , mView(Consumer.viewIndex(Config))
+    , mHistogram({HistogramAxis(HistogramAxis::Y, Config.mGeometry.YDim),
+                  HistogramAxis(HistogramAxis::Tof, Config.mTOF.BinSize, 0,
+                                Config.mTOF.MaxValue)})
+    , mCursor(Consumer.histogramTof2D().subscribe()) {
 
   connect(this, &QCustomPlot::mouseMove, this, &CustomAMOR2DTOFPlot::showPointToolTip);
   setAttribute(Qt::WA_AlwaysShowToolTips);
@@ -53,15 +51,25 @@ CustomAMOR2DTOFPlot::CustomAMOR2DTOFPlot(Configuration &Config,
   xAxis->setSubTicks(false);
   xAxis->setTickLabelRotation(90);
 
-  mColorMap = new QCPColorMap(xAxis, yAxis);
+  mColorMap = new LutColorMap(xAxis, yAxis);
 
   // we want the color map to have nx * ny data points
-  xAxis->setLabel("TOF");
+  // Non-linear TOF bins are shown by bin number, as cells are equally wide
+  double TofRange = mConfig.mTOF.MaxValue;
+  if (Binner::mode(mConfig.mTOF.Binning) == Binner::Linear) {
+    xAxis->setLabel("TOF");
+  } else {
+    xAxis->setLabel("TOF bin");
+    TofRange = mConfig.mTOF.BinSize;
+  }
   yAxis->setLabel("Y");
   mColorMap->data()->setSize(mConfig.mTOF.BinSize, geom.YDim);
-  mColorMap->data()->setRange(QCPRange(0, mConfig.mTOF.MaxValue),
+  mColorMap->data()->setRange(QCPRange(0, TofRange),
                               QCPRange(0, mConfig.mGeometry.YDim)); //
 
+  // cell (tof, y) is read directly from the row major histogram
+  mColorMap->setCells(mHistogram.storage(), 0, 1, mHistogram.stride(0));
+
   // add a color scale:
   mColorScale = new QCPColorScale(this);
 
@@ -149,49 +157,34 @@ CustomAMOR2DTOFPlot::getNextColorGradient(const std::string &GradientName) {
 }
 
 void CustomAMOR2DTOFPlot::clearDetectorImage() {
-  memset(HistogramData2D, 0, sizeof(HistogramData2D));
+  mHistogram.clear();
+  mStats.clear();
   plotDetectorImage(true);
 }
 
-void CustomAMOR2DTOFPlot::plotDetectorImage(bool Force) {
-  setCustomParameters();
+void CustomAMOR2DTOFPlot::plotDetectorImage(bool) {
+  // The color map reads the cells directly from mHistogram
+  mColorMap->cellsChanged();
 
-  for (int y = 0; y < mConfig.mGeometry.YDim; y++) {
-    for (unsigned int x = 0; x < mConfig.mTOF.BinSize; x++) {
-      if ((HistogramData2D[x][y] == 0) and (not Force)) {
-        continue;
-      }
-      // printf("debug x %u, y %u, z %u\n", x, y, HistogramData2D[x][y]);
-      mColorMap->data()->setCell(x, y, HistogramData2D[x][y]);
-    }
-  }
-
-  // rescale the data dimension (color) such that all data points lie in the
-  // span visualized by the color gradient:
-  mColorMap->rescaleDataRange(true);
+  // rescale the data dimension (color) from the running statistics
+  auto [Min, Max] = mStats.range(
+      size_t(mConfig.mGeometry.YDim) * mConfig.mTOF.BinSize,
+      mConfig.mPlot.RobustScale, mConfig.mPlot.ScaleLowPercentile,
+      mConfig.mPlot.ScaleHighPercentile);
+  mColorMap->setDataRange(QCPRange(Min, Max));
 
   replot();
 }
 
 void CustomAMOR2DTOFPlot::updateData() {
-  // Get newest histogram data from Consumer
-  vector<uint32_t> PixelIDs = mConsumer.readResetPixelIDs();
-  vector<uint32_t> TOFs = mConsumer.readResetTOFs();
-
-  // Accumulate counts, PixelId 0 does not exist
-  if (PixelIDs.size() == 0) {
-    return;
-  }
-
-  for (uint i = 0; i < PixelIDs.size(); i++) {
-    if (PixelIDs[i] == 0) {
-      continue;
-    }
-    int tof = TOFs[i];
-    int yvals = (PixelIDs[i] - 1) / mConfig.mGeometry.XDim;
-    HistogramData2D[tof][yvals]++;
+  // Get the (Y, TOF bin) counts histogrammed by the consumer since last time,
+  // the rows of the view have the same row major layout
+  const size_t First = mConsumer.views()[mView].RowBase * mConfig.mTOF.BinSize;
+  for (const auto &Delta : mConsumer.histogramTof2D().pull(mCursor)) {
+    mHistogram.merge(*Delta, [this](size_t, uint64_t Old, uint64_t New) {
+      mStats.update(Old, New);
+    }, 1, First);
   }
-  plotDetectorImage(false);
 
   return;
 }
@@ -9,6 +9,9 @@
 #pragma once
 
 #include <AbstractPlot.h>
+#include <Histogram.h>
+#include <LutColorMap.h>
+#include <ValueDistribution.h>
 
 #include <QPlot/qcustomplot/qcustomplot.h>
 
@@ -28,15 +31,15 @@ public:
   /// \brief plot needs the configurable plotting options
   CustomAMOR2DTOFPlot(Configuration &Config, ESSConsumer &Consumer);
 
-  /// \brief adds histogram data, clears periodically then calls
-  /// plotDetectorImage()
+  /// \brief adds the (Y, TOF) histogram data from the consumer, drawing is
+  /// left to plotDetectorImage()
   void updateData() override;
 
   /// \brief Support for different gradients
   QCPColorGradient getColorGradient(const std::string &GradientName);
 
   /// \brief update plot based on (possibly dynamic) config settings
-  void setCustomParameters();
+  void setCustomParameters() override;
 
   /// \brief rotate through gradient names
   std::string getNextColorGradient(const std::string &GradientName);
@@ -54,15 +57,23 @@ public slots:
 private:
   // QCustomPlot variables
   QCPColorScale *mColorScale{nullptr};
-  QCPColorMap *mColorMap{nullptr};
+  LutColorMap *mColorMap{nullptr};
 
   /// \brief configuration obtained from main()
   Configuration &mConfig;
 
-  /// \brief allocated according to config in constructor
-  #define TOF2DX 512
-  #define TOF2DY 512
-  uint32_t HistogramData2D[TOF2DX + 1][TOF2DY + 1];
+  /// \brief view of the consumer shown
+  size_t mView{0};
+
+  /// \brief (Y, TOF bin) counts, allocated according to config in constructor
+  /// with 16 bit counters that widen per block, so long runs do not wrap
+  Histogram<2, uint64_t, AdaptiveStorage> mHistogram;
+
+  /// \brief position in the (Y, TOF bin) deltas of the consumer
+  DeltaBus<uint32_t>::Cursor mCursor;
+
+  /// \brief running distribution of the histogram cells
+  ValueDistribution mStats;
 
   /// \brief for calculating x, y, z from pixelid
   ESSGeometry *LogicalGeometry;
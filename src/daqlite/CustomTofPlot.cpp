@@ -26,7 +26,17 @@ using std::vector;
 
 CustomTofPlot::CustomTofPlot(Configuration &Config, ESSConsumer &Consumer)
     : AbstractPlot(PlotType::TOF, Consumer)
-    , mConfig(Config) {
+    , mConfig(Config)
+    , mView(Consumer.viewIndex(Config))
+    , mUnit(FlightPathTable::unit(Config.mTOF.Unit))
+    , mBinner(Binner::create(Config.mTOF.Binning, Config.mTOF.BinSize,
+                             Config.mTOF.MinValue, Config.mTOF.MaxValue,
+                             Config.mTOF.BinEdges))
+    , mHistogram({HistogramAxis(HistogramAxis::Tof, Config.mTOF.BinSize, 0,
+                                maxX())})
+    , mTofCursor(Consumer.histogramTof().subscribe())
+    , mRoiCursor(Consumer.histogramRoi().subscribe())
+    , mPulseCursor(Consumer.pulses().subscribe()) {
   // Register callback functions for events
   connect(this, &QCustomPlot::mouseMove, this, &CustomTofPlot::showPointToolTip);
   setAttribute(Qt::WA_AlwaysShowToolTips);
@@ -34,8 +44,6 @@ CustomTofPlot::CustomTofPlot(Configuration &Config, ESSConsumer &Consumer)
   auto &geom = mConfig.mGeometry;
   LogicalGeometry = new ESSGeometry(geom.XDim, geom.YDim, geom.ZDim, 1);
 
-  HistogramTofData.resize(mConfig.mTOF.BinSize);
-
   // this will also allow rescaling the color scale by dragging/zooming
   setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
 
@@ -56,16 +64,30 @@ CustomTofPlot::CustomTofPlot(Configuration &Config, ESSConsumer &Consumer)
   // we want the color map to have nx * ny data points
 
   if (mConfig.mPlot.XAxis.empty()) {
-    xAxis->setLabel("TOF (us)");
+    if (mUnit == FlightPathTable::Wavelength) {
+      xAxis->setLabel("Wavelength (Å)");
+    } else if (mUnit == FlightPathTable::DSpacing) {
+      xAxis->setLabel("d-spacing (Å)");
+    } else {
+      xAxis->setLabel("TOF (us)");
+    }
   } else {
     xAxis->setLabel(mConfig.mPlot.XAxis.c_str());
   }
 
-  yAxis->setLabel("Counts");
-  xAxis->setRange(0, 50000);
+  yAxis->setLabel(mConfig.mPlot.NormalizePerPulse ? "Counts / pulse" : "Counts");
+  xAxis->setRange(0, (mUnit == FlightPathTable::Tof) ? 50000 : maxX());
 
   setCustomParameters();
 
+  // Fading replaces the rolling window and periodic clearing
+  mDecay.setup(mConfig.mPlot.HalfLifeSeconds);
+  if (not mDecay.enabled()) {
+    mWindow.setup((RoiTable::MaxRois + 1) * mHistogram.size(),
+                  mConfig.mPlot.RollingWindowSeconds,
+                  mConfig.mPlot.RollingSliceSeconds);
+  }
+
   t1 = std::chrono::high_resolution_clock::now();
 }
 
@@ -78,74 +100,265 @@ void CustomTofPlot::setCustomParameters() {
 }
 
 void CustomTofPlot::plotDetectorImage(bool Force) {
-  setCustomParameters();
-  mGraph->data()->clear();
-  uint32_t MaxY{0};
-  for (unsigned int i = 0; i < HistogramTofData.size(); i++) {
-    if ((HistogramTofData[i] != 0) or (Force)) {
-      uint32_t x = i * mConfig.mTOF.MaxValue / mConfig.mTOF.BinSize;
-      uint32_t y = HistogramTofData[i];
-      if (y > MaxY) {
-        MaxY = y;
-      }
-      mGraph->addData(x, y);
+  // Empty bins are only drawn when forced
+  const int Points = Force ? mHistogram.size() : mNonZeroBins;
+
+  // Only reallocate the graph data when the set of drawn bins changes,
+  // otherwise the sorted container is updated in place
+  auto Data = mGraph->data();
+  if (Data->size() != Points) {
+    Data->set(QVector<QCPGraphData>(Points), true);
+  }
+
+  const double Scale = countScale();
+  auto Point = Data->begin();
+  for (unsigned int i = 0; i < mHistogram.size(); i++) {
+    const double Count = mHistogram.at(i);
+    if ((Count != 0) or (Force)) {
+      Point->key = binValue(i);
+      Point->value = Count * Scale;
+      ++Point;
+    }
+  }
+
+  // ROI spectra are drawn for all bins
+  for (size_t r = 0; r < mRoiGraphs.size(); r++) {
+    auto RoiData = mRoiGraphs[r]->data();
+    const Histogram<1, double> &Roi = mRoiHistograms[r];
+    if (RoiData->size() != int(Roi.size())) {
+      RoiData->set(QVector<QCPGraphData>(Roi.size()), true);
+    }
+    auto RoiPoint = RoiData->begin();
+    for (unsigned int i = 0; i < Roi.size(); i++, ++RoiPoint) {
+      RoiPoint->key = binValue(i);
+      RoiPoint->value = Roi.at(i) * Scale;
     }
   }
 
   // yAxis->rescale();
   if (mConfig.mTOF.AutoScaleX) {
-    xAxis->setRange(0, mConfig.mTOF.MaxValue * 1.05);
+    xAxis->setRange(0, maxX() * 1.05);
   }
   if (mConfig.mTOF.AutoScaleY) {
-    yAxis->setRange(0, MaxY * 1.05);
+    yAxis->setRange(0, maxY() * Scale * 1.05);
   }
   replot();
 }
 
+double CustomTofPlot::binValue(size_t Bin) const {
+  if (mUnit == FlightPathTable::Tof) {
+    return mBinner.binCenter(Bin);
+  }
+  return mHistogram.axis(0).center(Bin);
+}
+
+bool CustomTofPlot::binOf(double Value, size_t &Bin) const {
+  if (mUnit == FlightPathTable::Tof) {
+    if (Value < 0 or Value > mBinner.maxValue()) {
+      return false;
+    }
+    Bin = mBinner.valToBin(Value);
+    return true;
+  }
+  return mHistogram.axis(0).bin(Value, Bin);
+}
+
+double CustomTofPlot::maxX() const {
+  if (mUnit == FlightPathTable::Tof) {
+    return mConfig.mTOF.MaxValue;
+  }
+  return mConfig.mTOF.UnitMaxValue;
+}
+
+double CustomTofPlot::countScale() const {
+  if (mConfig.mPlot.NormalizePerPulse and mPulses > 0) {
+    return mDecay.scale() / mPulses;
+  }
+  return mDecay.scale();
+}
+
+double CustomTofPlot::maxY() const {
+  if (mConfig.mPlot.RobustScale) {
+    return mStats.quantile(mConfig.mPlot.ScaleHighPercentile / 100.0);
+  }
+  return mStats.max();
+}
+
 void CustomTofPlot::updateData() {
   // printf("addData (TOF) Histogram size %lu\n", Histogram.size());
   auto t2 = std::chrono::high_resolution_clock::now();
   std::chrono::duration<int64_t, std::nano> elapsed = t2 - t1;
 
-  // Get histogram data from Consumer and clear it
-  vector<uint32_t> HistogramTof = mConsumer.readResetHistogramTof();
+  // Get the deltas published by the consumer since the last update
+  auto TofDeltas = mConsumer.histogramTof().pull(mTofCursor);
+  auto RoiDeltas = mConsumer.histogramRoi().pull(mRoiCursor);
+  auto PulseDeltas = mConsumer.pulses().pull(mPulseCursor);
 
-  // Periodically clear the histogram
+  // Subtract the counts that dropped out of the rolling window, or else
+  // periodically clear the histogram. Fading only changes the weight
+  double Weight = 1.0;
   int64_t nsBetweenClear = 1000000000LL * mConfig.mPlot.ClearEverySeconds;
-  if (mConfig.mPlot.ClearPeriodic and (elapsed.count() >= nsBetweenClear)) {
-    std::fill(HistogramTofData.begin(), HistogramTofData.end(), 0);
+  if (mDecay.enabled()) {
+    Weight = mDecay.advance(DecayScale::Clock::now());
+    if (mDecay.needsRenormalize()) {
+      renormalize();
+      Weight = 1.0;
+    }
+  } else if (mWindow.enabled()) {
+    mWindow.advance(RollingWindow<>::Clock::now(),
+                    [this](size_t First, const uint32_t *Counts, size_t Cells) {
+                      expire(First, Counts, Cells);
+                    });
+  } else if (mConfig.mPlot.ClearPeriodic and (elapsed.count() >= nsBetweenClear)) {
+    mHistogram.clear();
+    for (auto &Roi : mRoiHistograms) {
+      Roi.clear();
+    }
+    mStats.clear();
+    mNonZeroBins = 0;
+    mPulses = 0;
     t1 = std::chrono::high_resolution_clock::now();
   }
 
-  // Accumulate counts, PixelId 0 does not exist
-  for (unsigned int i = 1; i < HistogramTof.size(); i++) {
-    HistogramTofData[i] += HistogramTof[i];
+  // Only the pulses of messages histogrammed for the view, other sources
+  // may interleave theirs
+  for (const auto &Pulses : PulseDeltas) {
+    for (const auto &Pulse : *Pulses) {
+      if (((Pulse.Views >> mView) & 1) == 0) {
+        continue;
+      }
+      if (Pulse.Time != mLastPulseTime) {
+        mPulses++;
+        mLastPulseTime = Pulse.Time;
+      }
+    }
+  }
+
+  // Accumulate the counts of the view, tracking the distribution and the
+  // number of filled bins. The views follow each other, BinSize bins each
+  const size_t Bins = mHistogram.size();
+  const size_t First = mView * Bins;
+  for (const auto &HistogramTof : TofDeltas) {
+    mHistogram.merge(*HistogramTof, [this](size_t, double Old, double New) {
+      if (Old == 0) {
+        mNonZeroBins++;
+      }
+      mStats.update(Old, New);
+    }, Weight, First);
+    if (mWindow.enabled()) {
+      mWindow.add(*HistogramTof, 0, First, Bins);
+    }
+  }
+
+  // The ROI histograms follow each other, BinSize bins each
+  if (Bins == 0 or mView != 0) {
+    return;
+  }
+  for (const auto &Delta : RoiDeltas) {
+    const auto &HistogramRoi = *Delta;
+    if (mWindow.enabled()) {
+      mWindow.add(HistogramRoi, Bins);
+    }
+    addRoiGraphs(HistogramRoi.size() / Bins);
+    for (size_t r = 0; r < mRoiHistograms.size(); r++) {
+      if (HistogramRoi.size() < (r + 1) * Bins) {
+        break;
+      }
+      mRoiHistograms[r].merge(HistogramRoi, [](size_t, double, double) {},
+                              Weight, r * Bins);
+    }
   }
-  plotDetectorImage(false);
   return;
 }
 
+void CustomTofPlot::expire(size_t First, const uint32_t *Counts,
+                           size_t Cells) {
+  // A block may end one spectrum and start the next
+  const size_t Bins = mHistogram.size();
+  while (Cells > 0) {
+    const size_t Spectrum = First / Bins;
+    const size_t Bin = First % Bins;
+    const size_t Part = std::min(Cells, Bins - Bin);
+    if (Spectrum == 0) {
+      mHistogram.subtract(Bin, Counts, Part,
+                          [this](size_t, double Old, double New) {
+                            if (New == 0) {
+                              mNonZeroBins--;
+                            }
+                            mStats.update(Old, New);
+                          });
+    } else if (Spectrum - 1 < mRoiHistograms.size()) {
+      mRoiHistograms[Spectrum - 1].subtract(Bin, Counts, Part,
+                                            [](size_t, double, double) {});
+    }
+    First += Part;
+    Counts += Part;
+    Cells -= Part;
+  }
+}
+
+void CustomTofPlot::renormalize() {
+  const double Factor = mDecay.renormalize();
+  mHistogram.scale(Factor);
+  for (auto &Roi : mRoiHistograms) {
+    Roi.scale(Factor);
+  }
+
+  // The statistics are rebuilt from the scaled bins, which may underflow
+  mStats.clear();
+  mNonZeroBins = 0;
+  mHistogram.forEach([this](size_t, double Value) {
+    mStats.update(0, Value);
+    mNonZeroBins++;
+  });
+}
+
+void CustomTofPlot::addRoiGraphs(size_t Rois) {
+  if (Rois <= mRoiGraphs.size()) {
+    return;
+  }
+
+  auto Definitions = mConsumer.getRois();
+  for (size_t r = mRoiGraphs.size(); r < Rois; r++) {
+    mRoiHistograms.emplace_back();
+    mRoiHistograms.back().setAxes({mHistogram.axis(0)});
+
+    QCPGraph *Graph = new QCPGraph(xAxis, yAxis);
+    Graph->setLineStyle(QCPGraph::lsStepCenter);
+    Graph->setPen(QPen(QColor::fromHsv((r * 67) % 360, 255, 200)));
+    if (r < Definitions.size()) {
+      Graph->setName(QString::fromStdString(Definitions[r].Name));
+    }
+    mRoiGraphs.push_back(Graph);
+  }
+
+  // Name the graphs in the legend, the total graph first
+  mGraph->setName("All");
+  legend->setVisible(true);
+}
+
 void CustomTofPlot::clearDetectorImage() {
-  std::fill(HistogramTofData.begin(), HistogramTofData.end(), 0);
+  mHistogram.clear();
+  for (auto &Roi : mRoiHistograms) {
+    Roi.clear();
+  }
+  mStats.clear();
+  mWindow.clear();
+  mDecay.setup(mConfig.mPlot.HalfLifeSeconds);
+  mNonZeroBins = 0;
+  mPulses = 0;
   plotDetectorImage(true);
 }
 
 // MouseOver, display coordinate and data in tooltip
 void CustomTofPlot::showPointToolTip(QMouseEvent *event) {
-  int x = this->xAxis->pixelToCoord(event->pos().x());
+  double x = this->xAxis->pixelToCoord(event->pos().x());
 
-  // Calculate x coord width of the graphical representation of the column
-  int xCoordStep = int(mConfig.mTOF.MaxValue / mConfig.mTOF.BinSize);
+  // Get the bin under the cursor and its center
+  size_t Bin{0};
+  double count = binOf(x, Bin) ? mHistogram.at(Bin) * countScale() : 0;
+  double xCoordValue = binValue(Bin);
 
-  // Get the index in data store for the x coordinate
-  int xCoordDataIndex = int((x - xCoordStep / 2) / xCoordStep);
-
-  // Get coulmn middle TOF value for the x coordinate
-  int xCoordTofValue = int((x + xCoordStep / 2) / xCoordStep) * xCoordStep;
-
-  // Get the count value from the data store
-  const bool empty = mGraph->data()->isEmpty();
-  double count = (empty) ? 0 : mGraph->data()->at(xCoordDataIndex)->mainValue();
-
-  setToolTip(QString("Tof: %1 Count: %2").arg(xCoordTofValue).arg(count));
-}
\ No newline at end of file
+  const char *Label = (mUnit == FlightPathTable::Tof) ? "Tof" : "Value";
+  setToolTip(QString("%1: %2 Count: %3").arg(Label).arg(xCoordValue).arg(count));
+}
@@ -9,6 +9,12 @@
 #pragma once
 
 #include <AbstractPlot.h>
+#include <Binner.h>
+#include <DecayScale.h>
+#include <FlightPathTable.h>
+#include <Histogram.h>
+#include <RollingWindow.h>
+#include <ValueDistribution.h>
 
 #include <stdint.h>
 #include <vector>
@@ -30,12 +36,12 @@ public:
   /// \brief plot needs the configurable plotting options
   CustomTofPlot(Configuration &Config, ESSConsumer &Consumer);
 
-  /// \brief adds histogram data, clears periodically then calls
+  /// \brief adds histogram data and clears periodically, drawing is left to
   /// plotDetectorImage()
   void updateData() override;
 
   /// \brief update plot based on (possibly dynamic) config settings
-  void setCustomParameters();
+  void setCustomParameters() override;
 
   ///
   void clearDetectorImage() override;
@@ -54,7 +60,76 @@ private:
   /// \brief configuration obtained from main()
   Configuration &mConfig;
 
-  std::vector<uint32_t> HistogramTofData;
+  /// \brief view of the consumer shown, ROIs are only available for the
+  /// primary view 0
+  size_t mView{0};
+
+  /// \brief unit of the x axis, TOF or converted by the consumer
+  FlightPathTable::Unit mUnit;
+
+  /// \brief TOF binning, as in the consumer
+  Binner mBinner;
+
+  /// \brief counts per TOF (or wavelength, d-spacing) bin, weighted when
+  /// fading out old counts
+  Histogram<1, double> mHistogram;
+
+  /// \brief counts per TOF bin and graph for each ROI, in ROI order
+  std::vector<Histogram<1, double>> mRoiHistograms;
+  std::vector<QCPGraph *> mRoiGraphs;
+
+  /// \brief positions in the TOF, ROI and pulse deltas of the consumer
+  DeltaBus<uint32_t>::Cursor mTofCursor;
+  DeltaBus<uint32_t>::Cursor mRoiCursor;
+  SnapshotBus<std::vector<PulseCount>>::Cursor mPulseCursor;
+
+  /// \brief add histograms and graphs for ROIs defined since last time
+  void addRoiGraphs(size_t Rois);
+
+  /// \brief running distribution of the bin values
+  ValueDistribution mStats;
+
+  /// \brief counts of the last seconds, if showing a rolling window instead
+  /// of clearing periodically. Cells are the TOF bins followed by the TOF
+  /// bins of each ROI
+  RollingWindow<uint32_t> mWindow;
+
+  /// \brief subtract the counts of cells First to First + Cells - 1 that
+  /// dropped out of the rolling window
+  void expire(size_t First, const uint32_t *Counts, size_t Cells);
+
+  /// \brief weight of new counts when fading out old ones
+  DecayScale mDecay;
+
+  /// \brief multiply the histograms by the decay scale and restart the
+  /// weight
+  void renormalize();
+
+  /// \brief upper end of the binned range in the x axis unit
+  double maxX() const;
+
+  /// \brief center of a bin in the x axis unit, where lsStepCenter draws
+  /// the step of the bin
+  double binValue(size_t Bin) const;
+
+  /// \brief bin of an x axis value
+  /// \return false if the value is outside the binned range
+  bool binOf(double Value, size_t &Bin) const;
+
+  /// \brief upper Y value for autoscaling, the maximum or a high percentile
+  double maxY() const;
+
+  /// \brief number of bins with counts, tracked while accumulating
+  size_t mNonZeroBins{0};
+
+  /// \brief number of pulses accumulated, and the time of the last one to
+  /// count a pulse split over several messages only once
+  uint64_t mPulses{0};
+  int64_t mLastPulseTime{0};
+
+  /// \brief factor applied to the counts when drawing: 1 / pulses when
+  /// normalizing per pulse, and the decay scale when fading
+  double countScale() const;
 
   /// \brief for calculating x, y, z from pixelid
   ESSGeometry *LogicalGeometry;
@@ -0,0 +1,71 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file DecayScale.h
+///
+/// \brief Global scale for exponentially fading ("afterglow") histograms
+///
+/// Instead of multiplying every cell by the decay factor each frame, new
+/// counts are added with a weight that doubles every half-life, and the
+/// displayed value of a cell is its stored value times scale() = 1 / weight.
+/// Fading is then as cheap as accumulating. Only when the weight grows too
+/// large are the stored values multiplied by scale() once and the weight
+/// restarts from 1. Integer cells renormalize earlier to leave room for
+/// their counts.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <chrono>
+#include <cmath>
+
+class DecayScale {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// \brief Renormalize after 32 half-lives, stored values then stay within
+  /// the range of doubles and of ValueDistribution for 2^32 counts per cell
+  static constexpr double DefaultMaxWeight{4294967296.0};
+
+  /// \brief (re)start fading, 0 or less disables it
+  /// \param MaxWeight  weight above which the stored values are renormalized
+  void setup(double HalfLifeSeconds, double MaxWeight = DefaultMaxWeight) {
+    mHalfLife = HalfLifeSeconds;
+    mMaxWeight = MaxWeight;
+    mStart = mNow = Clock::now();
+    mWeight = 1.0;
+  }
+
+  bool enabled() const { return mHalfLife > 0; }
+
+  /// \brief move to the current time
+  /// \return the weight of counts added now
+  double advance(Clock::time_point Now) {
+    mNow = Now;
+    mWeight = std::exp2(std::chrono::duration<double>(mNow - mStart).count() /
+                        mHalfLife);
+    return mWeight;
+  }
+
+  /// \brief true if the stored values should be renormalized
+  bool needsRenormalize() const { return mWeight > mMaxWeight; }
+
+  /// \brief restart the weight from 1 at the current time
+  /// \return factor to multiply all stored values with
+  double renormalize() {
+    double Factor = scale();
+    mStart = mNow;
+    mWeight = 1.0;
+    return Factor;
+  }
+
+  /// \brief factor from stored to displayed values
+  double scale() const { return 1.0 / mWeight; }
+
+private:
+  double mHalfLife{0};
+  double mMaxWeight{DefaultMaxWeight};
+  double mWeight{1.0};
+  Clock::time_point mStart;
+  Clock::time_point mNow;
+};
@@ -12,17 +12,22 @@
 #include <ThreadSafeVector.h>
 
 #include <flatbuffers/flatbuffers.h>
+#include <librdkafka/rdkafka.h>
 #include <da00_dataarray_generated.h>
 #include <ev42_events_generated.h>
 #include <ev44_events_generated.h>
 
 #include <algorithm>
 #include <assert.h>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <fmt/format.h>
+#include <fmt/ranges.h>
 #include <memory>
+#include <stdexcept>
 #include <stdlib.h>
+#include <string_view>
 #include <sys/types.h>
 #include <unistd.h>
 #include <vector>
@@ -30,6 +35,21 @@
 using std::string;
 using std::vector;
 
+namespace {
+/// \brief the source name of a message, without copying it
+std::string_view sourceName(const flatbuffers::String *Name) {
+  return Name ? std::string_view(Name->c_str(), Name->size()) : std::string_view();
+}
+
+/// \brief the topic name of a message, without copying it as topic_name()
+/// does
+std::string_view topicName(RdKafka::Message *Msg) {
+  const rd_kafka_message_t *Raw = Msg->c_ptr();
+  return (Raw and Raw->rkt) ? std::string_view(rd_kafka_topic_name(Raw->rkt))
+                            : std::string_view();
+}
+} // namespace
+
 ESSConsumer::ESSConsumer(
     Configuration &Config,
     vector<std::pair<string, string>> &KafkaConfig)
@@ -37,17 +57,52 @@ ESSConsumer::ESSConsumer(
     , mKafkaConfig(KafkaConfig) {
   auto &geom = mConfig.mGeometry;
   mNumPixels = geom.XDim * geom.YDim * geom.ZDim;
-  mMinPixel = geom.Offset + 1;
-  mMaxPixel = geom.Offset + mNumPixels;
+
+  // The geometry of the plot(s) is the primary view, more views come from
+  // plots with their own geometry
+  vector<ViewTable::View> Views;
+  for (const auto &[G, Source, Topic] : mConfig.mViews) {
+    Views.push_back({G.XDim, G.YDim, G.ZDim, G.Offset, Source, Topic});
+  }
+  if (Views.empty()) {
+    Views.push_back({geom.XDim, geom.YDim, geom.ZDim, geom.Offset,
+                     mConfig.mKafka.Source, mConfig.mKafka.Topic});
+  }
+  mViews = ViewTable(std::move(Views));
+  mMinPixel = mViews.minPixel();
+  mMaxPixel = mViews.maxPixel();
   assert(mMaxPixel != 0);
   assert(mMinPixel < mMaxPixel);
 
+  if (mConfig.mTOF.PixelSpectra) {
+    mPixelTofCube.resize(mNumPixels, mConfig.mTOF.BinSize);
+  }
+
+  auto &tof = mConfig.mTOF;
+  mTofBinner = Binner::create(tof.Binning, tof.BinSize, tof.MinValue,
+                              tof.MaxValue, tof.BinEdges);
+
+  auto Unit = FlightPathTable::unit(mConfig.mTOF.Unit);
+  if (Unit != FlightPathTable::Tof) {
+    if (mConfig.mTOF.FlightPathFile.empty()) {
+      throw(std::runtime_error("TOF unit " + mConfig.mTOF.Unit +
+                               " needs a flight_path_file"));
+    }
+    // Pixel ids in the file are global, as in the messages, so it covers
+    // the pixels of all views
+    mFlightPaths.load(mConfig.mTOF.FlightPathFile, mMaxPixel);
+    mFlightPaths.setBinning(Unit, mConfig.mTOF.BinSize,
+                            mConfig.mTOF.UnitMaxValue);
+  }
+
+  mRoiTable = std::make_shared<const RoiTable>(geom.XDim, geom.YDim, geom.ZDim,
+                                               mConfig.mRois);
+
   mConsumer = subscribeTopic();
   assert(mConsumer != nullptr);
 
-  for (DataType t: {DataType::NONE, DataType::ANY, DataType::TOF, DataType::HISTOGRAM, DataType::HISTOGRAM_TOF, DataType::PIXEL_ID}) {
+  for (DataType t: {DataType::NONE, DataType::ANY, DataType::TOF, DataType::HISTOGRAM, DataType::HISTOGRAM_TOF, DataType::PIXEL_ID, DataType::HISTOGRAM_TOF2D, DataType::HISTOGRAM_ROI, DataType::PULSES}) {
     mSubscriptionCount[t] = 0;
-    mDeliveryCount[t] = 0;
   }
 }
 
@@ -84,74 +139,208 @@ RdKafka::KafkaConsumer *ESSConsumer::subscribeTopic() const {
     return nullptr;
   }
   //
-  // // Start consumer for topic+partition at start offset
-  RdKafka::ErrorCode resp = ret->subscribe({mConfig.mKafka.Topic});
+  // // Start consumer for the topics of all views at start offset
+  vector<string> Topics;
+  for (size_t t = 0; t < mViews.topics().size(); t++) {
+    Topics.push_back(mViews.topics().name(t));
+  }
+  if (Topics.empty()) {
+    Topics.push_back(mConfig.mKafka.Topic);
+  }
+  RdKafka::ErrorCode resp = ret->subscribe(Topics);
   if (resp != RdKafka::ERR_NO_ERROR) {
     fmt::print("Failed to subscribe consumer to '{}': {}\n",
-               mConfig.mKafka.Topic, err2str(resp));
+               fmt::join(Topics, ", "), err2str(resp));
   }
 
   return ret;
 }
 
-uint32_t ESSConsumer::processEV44Data(RdKafka::Message *Msg) {
-  auto EvMsg = GetEvent44Message(Msg->payload());
-  auto PixelIds = EvMsg->pixel_id();
-  auto TOFs = EvMsg->time_of_flight();
-
-  // If source name is set in config, only process messages from that source
-  if (!mConfig.mKafka.Source.empty() &&
-      EvMsg->source_name()->str() != mConfig.mKafka.Source) {
-    return 0;
+template <typename PixelIdVector, typename TofVector>
+uint32_t ESSConsumer::processEvents(const PixelIdVector &PixelIds,
+                                    const TofVector &TOFs,
+                                    vector<PulseCount> &Pulses,
+                                    ViewTable::Mask Accept) {
+  auto &geom = mConfig.mGeometry;
+  const uint32_t BinSize = mTofBinner.bins();
+
+  // Only histogram (Y, TOF) if a plot has asked for it
+  const bool Tof2D = mSubscriptionCount[DataType::HISTOGRAM_TOF2D] > 0;
+  const bool Spectra = mConfig.mTOF.PixelSpectra;
+  const bool Convert = mFlightPaths.enabled();
+
+  // One table for the whole message, even if ROIs are added meanwhile
+  const std::shared_ptr<const RoiTable> Rois = std::atomic_load(&mRoiTable);
+  const bool Regions = not Rois->empty();
+
+  // local temporary histograms to avoid locking during processing. Pixel
+  // cells of the views are collected as indices rather than counted in a
+  // dense vector, so a message only touches the pixels it hits
+  vector<uint32_t> PixelCells;
+  vector<uint32_t> TofBinVector(mViews.size() * BinSize, 0);
+  vector<uint32_t> Tof2DCells;
+  PackedEvents CubeEvents;
+  vector<uint32_t> RoiCells;
+  PixelCells.reserve(PixelIds.size());
+  if (Tof2D) {
+    Tof2DCells.reserve(PixelIds.size());
   }
-
-  if (PixelIds->size() != TOFs->size()) {
-    return 0;
+  if (Spectra) {
+    CubeEvents = mPixelTofCube.events();
+    CubeEvents.reserve(PixelIds.size());
   }
 
-  // local temporary histograms to avoid locking during processing
-  vector<uint32_t> PixelVector(mNumPixels, 0);
-  vector<uint32_t> TofBinVector(mConfig.mTOF.BinSize, 0);
+  // Events are ordered by pulse, so the pulse only changes at its first
+  // event index
+  const uint32_t Events = PixelIds.size();
+  size_t Pulse = 0;
+  uint32_t NextPulse = (Pulses.size() > 1) ? Pulses[1].First : Events;
 
-  for (uint i = 0; i < PixelIds->size(); i++) {
-    uint32_t Pixel = (*PixelIds)[i];
-    uint32_t Tof = (*TOFs)[i] / mConfig.mTOF.Scale; // ns to us
+  uint64_t Discarded = 0;
+  for (uint i = 0; i < Events; i++) {
+    const uint32_t Pixel = PixelIds[i];
 
-    // accumulate events for 2D TOF
-    uint32_t TofBin = std::min(Tof, mConfig.mTOF.MaxValue) *
-                      (mConfig.mTOF.BinSize - 1) / mConfig.mTOF.MaxValue;
-    mPixelIDs.push_back(Pixel);
-    mTOFs.push_back(TofBin);
+    while (i >= NextPulse) {
+      Pulse++;
+      NextPulse = (Pulse + 1 < Pulses.size()) ? Pulses[Pulse + 1].First : Events;
+    }
 
     if ((Pixel > mMaxPixel) or (Pixel < mMinPixel)) {
-      mEventDiscard++;
-    } else {
-      mEventAccept++;
+      Discarded++;
+      continue;
+    }
 
-      Pixel = Pixel - mConfig.mGeometry.Offset;
-      PixelVector[Pixel]++;
+    // one lookup gives all views of the pixel, there are gaps between views
+    const ViewTable::Mask InViews = mViews.mask(Pixel) & Accept;
+    if (InViews == 0) {
+      Discarded++;
+      continue;
+    }
+    if (Pulse < Pulses.size()) {
+      Pulses[Pulse].Events++;
+    }
 
-      Tof = std::min(Tof, mConfig.mTOF.MaxValue);
-      TofBinVector[Tof * (mConfig.mTOF.BinSize - 1) / mConfig.mTOF.MaxValue]++;
+    uint32_t Tof = TOFs[i] / mConfig.mTOF.Scale; // ns to us
+    uint32_t TofBin = mTofBinner.valToBin(Tof);
+
+    // Per pixel spectra and ROIs belong to the primary view
+    const bool Primary = (InViews & 1) != 0;
+    const uint32_t Local = Pixel - geom.Offset;
+
+    // The 1D spectra (total and ROIs) of all views are binned in the
+    // configured unit, flight paths are by global pixel id
+    uint32_t SpectrumBin = TofBin;
+    const bool InRange =
+        not Convert or mFlightPaths.bin(Pixel, Tof, SpectrumBin);
+
+    for (ViewTable::Mask Mask = InViews; Mask != 0; Mask &= Mask - 1) {
+      const size_t V = __builtin_ctz(Mask);
+      const ViewTable::View &View = mViews[V];
+      const uint32_t ViewPixel = Pixel - View.Offset;
+      PixelCells.push_back(View.PixelBase + ViewPixel);
+
+      if (InRange) {
+        TofBinVector[V * BinSize + SpectrumBin]++;
+      }
+
+      // accumulate events for 2D TOF, y as in ESSGeometry
+      if (Tof2D) {
+        uint32_t Y = ((ViewPixel - 1) / View.XDim) % View.YDim;
+        Tof2DCells.push_back((View.RowBase + Y) * BinSize + TofBin);
+      }
+    }
+
+    // accumulate events for the per pixel TOF spectra
+    if (Spectra and Primary) {
+      CubeEvents.push(Local - 1, TofBin);
+    }
+
+    // one lookup gives all ROIs of the pixel
+    if (Regions and Primary and InRange) {
+      for (RoiTable::Mask Mask = Rois->mask(Local); Mask != 0; Mask &= Mask - 1) {
+        RoiCells.push_back(__builtin_ctzll(Mask) * BinSize + SpectrumBin);
+      }
     }
   }
 
   // update thread safe histograms storage with new data
-  mHistogram.add_values(PixelVector);
+  mHistogram.increment(PixelCells, mViews.pixelCells());
   mHistogramTof.add_values(TofBinVector);
+  if (Tof2D) {
+    mHistogramTof2D.increment(Tof2DCells, mViews.rows() * BinSize);
+  }
+  if (Spectra) {
+    mPixelTofCube.add(CubeEvents);
+  }
+  if (Regions) {
+    mHistogramRoi.increment(RoiCells, Rois->size() * BinSize);
+  }
+  // Only collected if a plot reads them
+  for (auto &P : Pulses) {
+    P.Views = Accept;
+  }
+  if (not Pulses.empty() and mSubscriptionCount[DataType::PULSES] > 0) {
+    mPendingPulses.insert(mPendingPulses.end(), Pulses.begin(), Pulses.end());
+  }
+
+  mStats.add(ConsumerStats::Events, Events);
+  mStats.add(ConsumerStats::EventsAccepted, Events - Discarded);
+  mStats.add(ConsumerStats::DiscardPixel, Discarded);
+  return Events;
+}
+
+uint32_t ESSConsumer::processEV44Data(RdKafka::Message *Msg,
+                                     ViewTable::Mask Views) {
+  auto EvMsg = GetEvent44Message(Msg->payload());
+  auto PixelIds = EvMsg->pixel_id();
+  auto TOFs = EvMsg->time_of_flight();
+
+  // Only process messages of the sources of the views
+  const ViewTable::Mask Accept =
+      Views & mViews.sourceMask(sourceName(EvMsg->source_name()));
+  if (Accept == 0) {
+    mStats.add(ConsumerStats::SourceFiltered);
+    return 0;
+  }
+
+  if (PixelIds->size() != TOFs->size()) {
+    mStats.add(ConsumerStats::DiscardMalformed);
+    return 0;
+  }
+
+  // A message can hold several pulses, each starting at an event index
+  vector<PulseCount> Pulses;
+  auto Times = EvMsg->reference_time();
+  auto Indices = EvMsg->reference_time_index();
+  if (Times and Indices and Times->size() == Indices->size()) {
+    Pulses.reserve(Times->size());
+    for (uint p = 0; p < Times->size(); p++) {
+      uint32_t First = std::max((*Indices)[p], 0);
+
+      // Malformed indices would assign events to the wrong pulses
+      if (First > PixelIds->size() or
+          (not Pulses.empty() and First < Pulses.back().First)) {
+        Pulses.clear();
+        break;
+      }
+      Pulses.push_back({(*Times)[p], First, 0});
+    }
+  }
 
-  mEventCount += PixelIds->size();
-  return PixelIds->size();
+  return processEvents(*PixelIds, *TOFs, Pulses, Accept);
 }
 
-uint32_t ESSConsumer::processDA00Data(RdKafka::Message *Msg) {
+uint32_t ESSConsumer::processDA00Data(RdKafka::Message *Msg,
+                                     ViewTable::Mask Views) {
   auto EvMsg = Getda00_DataArray(Msg->payload());
   if (EvMsg->data()->size() == 0) {
+    mStats.add(ConsumerStats::DiscardMalformed);
     return 0;
   }
 
-  if (!mConfig.mKafka.Source.empty() &&
-      EvMsg->source_name()->str() != mConfig.mKafka.Source) {
+  // The data bins are not split by view, only filtered by source
+  if ((Views & mViews.sourceMask(sourceName(EvMsg->source_name()))) == 0) {
+    mStats.add(ConsumerStats::SourceFiltered);
     return 0;
   }
 
@@ -164,74 +353,56 @@ uint32_t ESSConsumer::processDA00Data(RdKafka::Message *Msg) {
   // Bin edges has one plus element to describe last edge compared to the data
   // which has as many elements as bins
   if (BinEdges.size() != DataBins.size() + 1) {
-    mEventDiscard++;
+    mStats.add(ConsumerStats::DiscardMalformed);
     return 0;
   }
 
   int64_t MaxTime = *std::max_element(BinEdges.begin(), BinEdges.end());
 
   if (MaxTime / mConfig.mTOF.Scale > mConfig.mTOF.MaxValue) {
+    mStats.add(ConsumerStats::DiscardTofRange);
     return 0;
   }
 
-  mHistogram.add_values(DataBins);
+  // Own bus, the pixel histograms of ev44 topics of the broker must not mix
+  // with the data bins
+  mHistogramData.add_values(DataBins);
   mTOFs = BinEdges;
 
   mConfig.mTOF.BinSize = BinEdges.size() - 1;
 
-  mEventCount++;
-  mEventAccept++;
-  return mHistogram.size();
+  mStats.add(ConsumerStats::Events);
+  mStats.add(ConsumerStats::EventsAccepted);
+  return DataBins.size();
 }
 
-uint32_t ESSConsumer::processEV42Data(RdKafka::Message *Msg) {
+uint32_t ESSConsumer::processEV42Data(RdKafka::Message *Msg,
+                                     ViewTable::Mask Views) {
   auto EvMsg = GetEventMessage(Msg->payload());
   auto PixelIds = EvMsg->detector_id();
   auto TOFs = EvMsg->time_of_flight();
 
-  // If source name is set in config, only process messages from that source
-  if (!mConfig.mKafka.Source.empty() &&
-      EvMsg->source_name()->str() != mConfig.mKafka.Source) {
+  // Only process messages of the sources of the views
+  const ViewTable::Mask Accept =
+      Views & mViews.sourceMask(sourceName(EvMsg->source_name()));
+  if (Accept == 0) {
+    mStats.add(ConsumerStats::SourceFiltered);
     return 0;
   }
 
   if (PixelIds->size() != TOFs->size()) {
+    mStats.add(ConsumerStats::DiscardMalformed);
     return 0;
   }
 
-  vector<uint32_t> PixelVector(mNumPixels, 0);
-  vector<uint32_t> TofBinVector(mConfig.mTOF.BinSize, 0);
-
-  for (uint i = 0; i < PixelIds->size(); i++) {
-    uint32_t Pixel = (*PixelIds)[i];
-    uint32_t Tof = (*TOFs)[i] / mConfig.mTOF.Scale; // ns to us
-
-    // accumulate events for 2D TOF
-    uint32_t TofBin = std::min(Tof, mConfig.mTOF.MaxValue) *
-                      (mConfig.mTOF.BinSize - 1) / mConfig.mTOF.MaxValue;
-    mPixelIDs.push_back(Pixel);
-    mTOFs.push_back(TofBin);
-
-    if ((Pixel > mMaxPixel) or (Pixel < mMinPixel)) {
-      mEventDiscard++;
-    } else {
-      mEventAccept++;
-      Pixel = Pixel - mConfig.mGeometry.Offset;
-      PixelVector[Pixel]++;
-      Tof = std::min(Tof, mConfig.mTOF.MaxValue);
-      TofBinVector[Tof * (mConfig.mTOF.BinSize - 1) / mConfig.mTOF.MaxValue]++;
-    }
-  }
-
-  mHistogram.add_values(PixelVector);
-  mHistogramTof.add_values(TofBinVector);
+  // One pulse per message
+  vector<PulseCount> Pulses{{int64_t(EvMsg->pulse_time()), 0, 0}};
 
-  mEventCount += PixelIds->size();
-  return PixelIds->size();
+  return processEvents(*PixelIds, *TOFs, Pulses, Accept);
 }
 
 bool ESSConsumer::handleMessage(RdKafka::Message *Message) {
-  mKafkaStats.MessagesRx++;
+  mStats.add(ConsumerStats::MessagesRx);
 
   const uint8_t *FlatBuffer = static_cast<const uint8_t *>(Message->payload());
 
@@ -239,42 +410,48 @@ bool ESSConsumer::handleMessage(RdKafka::Message *Message) {
 
   switch (Message->err()) {
   case RdKafka::ERR__TIMED_OUT:
-    mKafkaStats.MessagesTMO++;
+    mStats.add(ConsumerStats::MessagesTimeout);
+    publishDeltas(true);
     return false;
     break;
 
-  case RdKafka::ERR_NO_ERROR:
-    mKafkaStats.MessagesData++;
+  case RdKafka::ERR_NO_ERROR: {
+    mStats.add(ConsumerStats::MessagesData);
+    mStats.add(ConsumerStats::Bytes, Message->len());
 
+    // Views of the topic, the topics of the broker share the consumer
+    const ViewTable::Mask Views = mViews.topicMask(topicName(Message));
     if (VerifyEvent44MessageBuffer(Verifier)) {
-      processEV44Data(Message);
+      processEV44Data(Message, Views);
     } else if (VerifyEventMessageBuffer(Verifier)) {
-      processEV42Data(Message);
+      processEV42Data(Message, Views);
     } else if (Verifyda00_DataArrayBuffer(Verifier)) {
-      processDA00Data(Message);
+      processDA00Data(Message, Views);
     } else {
-      mKafkaStats.MessagesUnknown++;
+      mStats.add(ConsumerStats::VerifyFailures);
       fmt::print("Unknown message type\n");
       return false;
     }
 
+    publishDeltas(false);
     return true;
     break;
+  }
 
   case RdKafka::ERR__PARTITION_EOF:
-    mKafkaStats.MessagesEOF++;
+    mStats.add(ConsumerStats::MessagesEof);
     return false;
     break;
 
   case RdKafka::ERR__UNKNOWN_TOPIC:
   case RdKafka::ERR__UNKNOWN_PARTITION:
-    mKafkaStats.MessagesUnknown++;
+    mStats.add(ConsumerStats::MessagesUnknown);
     fmt::print("Consume failed: {}\n", Message->errstr());
     return false;
     break;
 
   default: // Other errors
-    mKafkaStats.MessagesOther++;
+    mStats.add(ConsumerStats::MessagesOther);
     fmt::print("Consume failed: {}", Message->errstr());
     return false;
   }
@@ -341,73 +518,77 @@ ESSConsumer::getDataVector(const da00_Variable &Variable) const {
   return Data;
 }
 
-/// \todo is timeout reasonable?
-std::unique_ptr<RdKafka::Message> ESSConsumer::consume() {
-  std::unique_ptr<RdKafka::Message> msg(mConsumer->consume(1000));
+std::unique_ptr<RdKafka::Message> ESSConsumer::consume(int TimeoutMs) {
+  std::unique_ptr<RdKafka::Message> msg(mConsumer->consume(TimeoutMs));
   return msg;
 }
 
 
-/// \brief read out the histogram data and reset it
-vector<uint32_t> ESSConsumer::readResetHistogram() {
-  vector<uint32_t> ret = mHistogram;
-
-  if (checkDelivery(DataType::HISTOGRAM)) {
-    mHistogram.clear();
+void ESSConsumer::publishDeltas(bool Idle) {
+  const auto Now = std::chrono::steady_clock::now();
+  if (not Idle and Now - mLastPublish < PublishPeriod) {
+    return;
+  }
+  mLastPublish = Now;
+
+  mHistogram.publish();
+  mHistogramTof.publish();
+  mHistogramTof2D.publish();
+  mHistogramData.publish();
+  mHistogramRoi.publish();
+  if (not mPendingPulses.empty()) {
+    mPulses.publish(std::move(mPendingPulses));
+    mPendingPulses.clear();
   }
-
-  return ret;
 }
 
-/// \brief read out the TOF histogram data and reset it
-vector<uint32_t> ESSConsumer::readResetHistogramTof() {
-  vector<uint32_t> ret = mHistogramTof;
-
-  if (checkDelivery(DataType::HISTOGRAM_TOF)) {
-    mHistogramTof.clear();
-  }
+vector<uint32_t> ESSConsumer::getTofs() const {
+  vector<uint32_t> ret = mTOFs;
 
   return ret;
 }
 
-/// \brief read out the event pixel IDs and clear the vector
-vector<uint32_t> ESSConsumer::readResetPixelIDs() {
-  vector<uint32_t> ret = mPixelIDs;
-
-  if (checkDelivery(DataType::PIXEL_ID)) {
-    mPixelIDs.clear();
+size_t ESSConsumer::viewIndex(const Configuration &Config) const {
+  const auto &G = Config.mGeometry;
+  for (size_t v = 0; v < mViews.size(); v++) {
+    if (mViews[v].sameGeometry(G.XDim, G.YDim, G.ZDim, G.Offset) and
+        mViews[v].Source == Config.mKafka.Source and
+        mViews[v].Topic == Config.mKafka.Topic) {
+      return v;
+    }
   }
-
-
-  return ret;
+  throw std::runtime_error("Plot geometry is not a view of the consumer");
 }
 
-/// \brief read out the event TOFs and clear the vector
-vector<uint32_t> ESSConsumer::readResetTOFs() {
-  vector<uint32_t> ret = mTOFs;
+vector<RoiTable::Roi> ESSConsumer::getRois() const {
+  return std::atomic_load(&mRoiTable)->rois();
+}
 
-  if (checkDelivery(DataType::TOF)) {
-    mTOFs.clear();
+bool ESSConsumer::addRoi(const RoiTable::Roi &Roi) {
+  auto Current = std::atomic_load(&mRoiTable);
+  if (Current->size() >= RoiTable::MaxRois) {
+    return false;
   }
 
-  return ret;
-}
+  auto Rois = Current->rois();
+  Rois.push_back(Roi);
 
-vector<uint32_t> ESSConsumer::getTofs() const {
-  vector<uint32_t> ret = mTOFs;
-
-  return ret;
+  auto &geom = mConfig.mGeometry;
+  std::atomic_store(&mRoiTable, std::shared_ptr<const RoiTable>(
+      std::make_shared<RoiTable>(geom.XDim, geom.YDim, geom.ZDim, Rois)));
+  return true;
 }
 
-bool ESSConsumer::checkDelivery(DataType Type) {
-  mDeliveryCount[Type] += 1;
-  if (mDeliveryCount[Type] == mSubscriptionCount[Type]) {
-    mDeliveryCount[Type] = 0;
-
-    return true;
+vector<uint64_t>
+ESSConsumer::getPixelSpectrum(const vector<uint32_t> &PixelIds) const {
+  vector<uint32_t> Pixels;
+  Pixels.reserve(PixelIds.size());
+  for (const auto PixelId : PixelIds) {
+    if (PixelId != 0) {
+      Pixels.push_back(PixelId - 1);
+    }
   }
-
-  return false;
+  return mPixelTofCube.spectrum(Pixels);
 }
 
 void ESSConsumer::addSubscriber(PlotType Type) {
@@ -421,11 +602,16 @@ void ESSConsumer::addSubscriber(PlotType Type) {
   {
     case PlotType::TOF:
       mSubscriptionCount[DataType::HISTOGRAM_TOF] += 1;
+      mSubscriptionCount[DataType::HISTOGRAM_ROI] += 1;
+      mSubscriptionCount[DataType::PULSES] += 1;
+      break;
+
+    case PlotType::PULSES:
+      mSubscriptionCount[DataType::PULSES] += 1;
       break;
 
     case PlotType::TOF2D:
-      mSubscriptionCount[DataType::PIXEL_ID] += 1;
-      mSubscriptionCount[DataType::TOF] += 1;
+      mSubscriptionCount[DataType::HISTOGRAM_TOF2D] += 1;
       break;
 
     case PlotType::PIXELS:
@@ -445,19 +631,3 @@ void ESSConsumer::addSubscriber(PlotType Type) {
   //   fmt::print("ESSConsumer::addSubscriber {} {}\n", Type, mSubscriptionCount[dt]);
   // }
 }
-
-void ESSConsumer::gotEventRequest() {
-  mEventRequests += 1;
-
-  // Reset if all event requests have been delivered
-  if (mEventRequests == mSubscriptionCount[DataType::ANY]) {
-      mEventCount = 0;
-      mEventAccept = 0;
-      mEventDiscard = 0;
-
-      mEventRequests = 0;
-  }
-}
-
-
-
@@ -10,11 +10,19 @@
 
 #pragma once
 
+#include <Binner.h>
+#include <ConsumerStats.h>
+#include <FlightPathTable.h>
+#include <PixelTofCube.h>
+#include <RoiTable.h>
+#include <SnapshotBus.h>
 #include <ThreadSafeVector.h>
+#include <ViewTable.h>
 #include <types/DataType.h>
 
 #include <librdkafka/rdkafkacpp.h>
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <map>
@@ -28,6 +36,14 @@ class Configuration;
 class PlotType;
 struct da00_Variable;
 
+/// \brief Accepted events of one neutron pulse
+struct PulseCount {
+  int64_t Time{0};    ///< Pulse (reference) time, ns since epoch
+  uint32_t First{0};  ///< Index of the first event of the pulse in a message
+  uint32_t Events{0}; ///< Number of accepted events
+  uint32_t Views{0};  ///< Views the message was histogrammed for (bit mask)
+};
+
 /// \class ESSConsumer
 /// \brief A class to handle Kafka consumer operations for ESS data.
 ///
@@ -66,7 +82,8 @@ public:
               std::vector<std::pair<std::string, std::string>> &KafkaConfig);
 
   /// \brief wrapper function for librdkafka consumer
-  std::unique_ptr<RdKafka::Message> consume();
+  /// \param TimeoutMs  Maximum time to wait for a message
+  std::unique_ptr<RdKafka::Message> consume(int TimeoutMs = 1000);
 
   /// \brief setup librdkafka parameters for Broker and Topic
   RdKafka::KafkaConsumer *subscribeTopic() const;
@@ -75,106 +92,163 @@ public:
   /// \return true if message contains data, false otherwise
   bool handleMessage(RdKafka::Message *message);
 
-  /// \brief return a random group id so that simultaneous consume from  fmt::print("ESSConsumer::readResetTOFs: Clearing = {} {} {}\n\n", mSubscriptionCount[DataType::TOF], mDeliveryCount[DataType::TOF]);
-
+  /// \brief return a random group id so that simultaneous consume from
   /// multiple applications is possible.
   static std::string randomGroupString(size_t length);
 
-  size_t getHistogramSize() const { return mHistogram.size(); }
-  size_t getHistogramTofSize() const { return mHistogramTof.size(); }
-  size_t getPixelIDsSize() const { return mPixelIDs.size(); }
   size_t getTOFsSize() const { return mTOFs.size(); }
 
-  uint64_t getEventCount() const { return mEventCount; };
-  uint64_t getEventAccept() const { return mEventAccept; };
-  uint64_t getEventDiscard() const { return mEventDiscard; };
+  /// \brief monotonic statistics counters, readable from any thread
+  const ConsumerStats &stats() const { return mStats; }
+
+  /// \brief deltas of the pixel histograms of the views (local pixel ids as
+  /// indices from the PixelBase of the view)
+  ///
+  /// Each plot subscribes a cursor and pulls the deltas published since its
+  /// last pull, independently of the other plots
+  const DeltaBus<uint32_t> &histogram() const { return mHistogram; }
+
+  /// \brief deltas of the da00 data bins, one per time bin
+  const DeltaBus<uint64_t> &histogramData() const { return mHistogramData; }
 
-  /// \brief read out the histogram data and reset it
-  std::vector<uint32_t> readResetHistogram();
+  /// \brief deltas of the TOF histograms of the views, BinSize bins each in
+  /// view order
+  const DeltaBus<uint32_t> &histogramTof() const { return mHistogramTof; }
 
-  /// \brief read out the TOF histogram data and reset it
-  std::vector<uint32_t> readResetHistogramTof();
+  /// \brief deltas of the (Y, TOF bin) histogram
+  ///
+  /// Row major, YDim rows of BinSize TOF bins for each view, from the
+  /// RowBase of the view
+  const DeltaBus<uint32_t> &histogramTof2D() const { return mHistogramTof2D; }
 
-  /// \brief read out the event pixel IDs and reset it
-  std::vector<uint32_t> readResetPixelIDs();
+  /// \brief deltas of the TOF histograms of the ROIs
+  ///
+  /// One block of BinSize TOF bins per ROI, in ROI order
+  const DeltaBus<uint32_t> &histogramRoi() const { return mHistogramRoi; }
 
-  /// \brief read out the event TOFs and reset it
-  std::vector<uint32_t> readResetTOFs();
+  /// \brief per pulse event counts
+  const SnapshotBus<std::vector<PulseCount>> &pulses() const { return mPulses; }
 
-  /// \brief read out the event TOFs (no reset)
+  /// \brief the geometry views, and the layout of their histograms
+  const ViewTable &views() const { return mViews; }
+
+  /// \brief the view of a plot configuration, by its geometry, source and
+  /// topic
+  size_t viewIndex(const Configuration &Config) const;
+
+  /// \brief the current ROIs, in ROI order
+  std::vector<RoiTable::Roi> getRois() const;
+
+  /// \brief add a ROI, it is histogrammed from the next message on
+  /// \return false if the maximum number of ROIs is reached
+  bool addRoi(const RoiTable::Roi &Roi);
+
+  /// \brief read out the DA00 time bin edges (no reset)
   std::vector<uint32_t> getTofs() const;
 
+  /// \brief true if per pixel TOF spectra are accumulated (tof.pixel_spectra)
+  bool hasPixelSpectra() const { return mConfig.mTOF.PixelSpectra; }
+
+  /// \brief summed TOF spectrum of a set of pixels since start or last clear
+  /// \param PixelIds  Pixel ids without offset, starting from 1
+  std::vector<uint64_t> getPixelSpectrum(const std::vector<uint32_t> &PixelIds) const;
+
+  /// \brief reset the per pixel TOF spectra
+  void clearPixelSpectra() { mPixelTofCube.clear(); }
+
   /// \brief Add a new plot subscribing for data
   ///
   /// \param Type  The plot type
   void addSubscriber(PlotType Type);
 
-  /// Call this after pulling events data. Cleared all subscriptions have been delivered
-  void gotEventRequest();
-
 private:
   RdKafka::Conf *mConf;
   RdKafka::Conf *mTConf;
   RdKafka::KafkaConsumer *mConsumer;
   RdKafka::Topic *mTopic;
 
-  uint64_t mEventCount{0};
-  uint64_t mEventAccept{0};
-  uint64_t mEventDiscard{0};
+  ConsumerStats mStats;
+
+  /// \brief Deltas are published at most this often while messages arrive,
+  /// and whenever the consumer is idle
+  static constexpr std::chrono::milliseconds PublishPeriod{50};
 
-  // Thread safe histogram data storage
-  ThreadSafeVector<uint32_t, int64_t> mHistogram;
-  ThreadSafeVector<uint32_t, int64_t> mHistogramTof;
-  ThreadSafeVector<uint32_t, int64_t> mPixelIDs;
+  // Lock-free hand-off of the histogram deltas to the plots
+  DeltaBus<uint32_t> mHistogram;
+  DeltaBus<uint32_t> mHistogramTof;
+  DeltaBus<uint32_t> mHistogramTof2D;
+  DeltaBus<uint64_t> mHistogramData;
+  std::chrono::steady_clock::time_point mLastPublish;
+
+  /// \brief DA00 time bin edges
   ThreadSafeVector<uint32_t, int64_t> mTOFs;
 
+  /// \brief (pixel, TOF bin) counts, only allocated if enabled
+  PixelTofCube mPixelTofCube;
+
+  /// \brief linear, log or arbitrary edge TOF binning
+  Binner mTofBinner;
+
+  /// \brief optional TOF to wavelength or d-spacing conversion of the
+  /// TOF and ROI spectra
+  FlightPathTable mFlightPaths;
+
+  /// \brief (ROI, TOF bin) counts
+  DeltaBus<uint32_t> mHistogramRoi;
+
+  /// \brief per pulse event counts, and those not yet published
+  SnapshotBus<std::vector<PulseCount>> mPulses;
+  std::vector<PulseCount> mPendingPulses;
+
+  /// \brief pixel to view masks and histogram layout of the views
+  ViewTable mViews;
+
+  /// \brief pixel to ROI masks, replaced as a whole when ROIs are added so
+  /// the decode loop never waits for the GUI
+  std::shared_ptr<const RoiTable> mRoiTable;
+
   /// \brief configuration obtained from main()
   Configuration &mConfig;
 
   /// \brief loadable Kafka-specific configuration
   std::vector<std::pair<std::string, std::string>> &mKafkaConfig;
 
-  /// \brief histograms the event pixelids and ignores TOF
-  uint32_t processEV42Data(RdKafka::Message *Msg);
+  /// \brief histograms the ev42 event pixelids and TOFs
+  /// \param Views  Views accepting the topic of the message
+  uint32_t processEV42Data(RdKafka::Message *Msg, ViewTable::Mask Views);
+
+  /// \brief histograms the ev44 event pixelids and TOFs
+  /// \param Views  Views accepting the topic of the message
+  uint32_t processEV44Data(RdKafka::Message *Msg, ViewTable::Mask Views);
 
-  /// \brief histograms the event pixelids and ignores TOF
-  uint32_t processEV44Data(RdKafka::Message *Msg);
+  /// \brief publish the deltas accumulated since the last publication
+  /// \param Idle  publish now, no messages are arriving
+  void publishDeltas(bool Idle);
+
+  /// \brief decode kernel shared by ev42 and ev44: accumulates the pixel,
+  /// TOF and (Y, TOF) histograms for the events of one message
+  /// \param Pulses  Pulses of the message by first event index, their
+  ///                accepted events are counted in the same pass
+  /// \param Accept  Views accepting the source of the message
+  template <typename PixelIdVector, typename TofVector>
+  uint32_t processEvents(const PixelIdVector &PixelIds, const TofVector &TOFs,
+                         std::vector<PulseCount> &Pulses,
+                         ViewTable::Mask Accept);
 
   /// \brief histograms the DA00 TOF data bins
-  uint32_t processDA00Data(RdKafka::Message *Msg);
+  /// \param Views  Views accepting the topic of the message
+  uint32_t processDA00Data(RdKafka::Message *Msg, ViewTable::Mask Views);
 
   std::vector<int64_t> getDataVector(const da00_Variable &Variable) const;
 
-  /// \brief Some stat counters
-  /// \todo use or delete?
-  struct Stat {
-    uint64_t MessagesRx{0};
-    uint64_t MessagesTMO{0};
-    uint64_t MessagesData{0};
-    uint64_t MessagesEOF{0};
-    uint64_t MessagesUnknown{0};
-    uint64_t MessagesOther{0};
-  } mKafkaStats;
-
-  uint32_t mNumPixels{0}; ///< Number of pixels
-  uint32_t mMinPixel{0};  ///< Offset
-  uint32_t mMaxPixel{0};  ///< Number of pixels + offset
-
-  /// \brief  Check if all deliveries have been made for a given data type
-  /// \param  Type  Check for this data type
-  /// \return true if all deliveries are done
-  bool checkDelivery(DataType Type);
+  uint32_t mNumPixels{0}; ///< Number of pixels of the primary view
+  uint32_t mMinPixel{0};  ///< Lowest pixel id of all views
+  uint32_t mMaxPixel{0};  ///< Highest pixel id of all views
 
   /// \brief Number of plots subscribing to ESSConsumer data (is incremented
   ///        when calling addSubscriber)
   size_t mSubscribers{0};
 
-  /// \brief  Count the current number of request for event stats
-  size_t mEventRequests{0};
-
   /// \brief The number of subscribers for each data type
   std::map<DataType, size_t> mSubscriptionCount;
-
-  /// \brief The number of deliveries made so far for different data types
-  std::map<DataType, size_t> mDeliveryCount;
 };
@@ -0,0 +1,93 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file FlightPathTable.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include <FlightPathTable.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+FlightPathTable::Unit FlightPathTable::unit(const std::string &Name) {
+  std::string Lower = Name;
+  std::transform(Lower.begin(), Lower.end(), Lower.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+
+  if (Lower == "tof") {
+    return Tof;
+  } else if (Lower == "wavelength") {
+    return Wavelength;
+  } else if (Lower == "dspacing") {
+    return DSpacing;
+  }
+  throw std::invalid_argument("Invalid TOF unit: " + Name);
+}
+
+void FlightPathTable::load(const std::string &FileName, uint32_t MaxPixel) {
+  std::ifstream File(FileName);
+  if (!File.good()) {
+    throw(std::runtime_error("Unable to open flight path file " + FileName));
+  }
+
+  mFlightPath.assign(MaxPixel + 1, 0.0);
+  mTwoTheta.assign(MaxPixel + 1, 0.0);
+
+  std::string Line;
+  size_t Loaded{0};
+  while (std::getline(File, Line)) {
+    if (Line.empty() or Line[0] == '#') {
+      continue;
+    }
+
+    std::istringstream Fields(Line);
+    uint32_t PixelId;
+    double FlightPath, TwoTheta;
+    if (!(Fields >> PixelId >> FlightPath >> TwoTheta)) {
+      throw(std::runtime_error("Bad line in flight path file: " + Line));
+    }
+    if (PixelId == 0 or PixelId > MaxPixel or FlightPath <= 0) {
+      continue;
+    }
+
+    mFlightPath[PixelId] = FlightPath;
+    mTwoTheta[PixelId] = TwoTheta * M_PI / 180.0;
+    Loaded++;
+  }
+
+  fmt::print("Loaded flight paths for {} pixels up to pixel id {} from {}\n",
+             Loaded, MaxPixel, FileName);
+}
+
+void FlightPathTable::setBinning(Unit Type, uint32_t Bins, double MaxValue) {
+  mUnit = Type;
+  mBins = Bins;
+  mBinsPerUs.assign(mFlightPath.size(), 0.0f);
+  if (Type == Tof or MaxValue <= 0) {
+    return;
+  }
+
+  // value [A] = (h / m_n) * 1e-6 [s / us] * t [us] / L [m] (/ 2 sin(theta))
+  const double BinsPerUnit = Bins / MaxValue;
+  for (size_t Pixel = 0; Pixel < mFlightPath.size(); Pixel++) {
+    if (mFlightPath[Pixel] <= 0) {
+      continue;
+    }
+    double PerUs = PlanckOverNeutronMass * 1e-6 / mFlightPath[Pixel];
+    if (Type == DSpacing) {
+      double SinTheta = std::sin(mTwoTheta[Pixel] / 2);
+      if (SinTheta <= 0) {
+        continue;
+      }
+      PerUs /= 2 * SinTheta;
+    }
+    mBinsPerUs[Pixel] = float(PerUs * BinsPerUnit);
+  }
+}
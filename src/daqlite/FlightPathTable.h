@@ -0,0 +1,76 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file FlightPathTable.h
+///
+/// \brief Per pixel TOF to wavelength or d-spacing conversion
+///
+/// The total flight path L1 + L2 and the scattering angle 2 theta of every
+/// pixel are loaded from a text file. They are folded into one multiplier
+/// per pixel, so converting and binning an event is a table lookup and a
+/// multiplication:
+///
+///   lambda [A] = 3956.034 [m A / s] * t / L
+///   d [A]      = lambda / (2 sin(theta))
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class FlightPathTable {
+public:
+  enum Unit { Tof, Wavelength, DSpacing };
+
+  /// \brief unit from its configuration name ("tof", "wavelength",
+  /// "dspacing")
+  static Unit unit(const std::string &Name);
+
+  /// \brief load L1 + L2 and 2 theta per pixel
+  ///
+  /// One pixel per line, "pixel_id flight_path_m two_theta_deg", pixel ids
+  /// as in the event messages, so one file covers all views. Empty lines and
+  /// lines starting with '#' are ignored, pixels not in the file are not
+  /// converted.
+  /// \param MaxPixel  Highest pixel id of all views
+  void load(const std::string &FileName, uint32_t MaxPixel);
+
+  /// \brief precompute the bins per microsecond of every pixel
+  /// \param Type     Target unit, Tof disables the conversion
+  /// \param Bins     Number of bins
+  /// \param MaxValue Upper end of the binned range in the target unit
+  void setBinning(Unit Type, uint32_t Bins, double MaxValue);
+
+  /// \brief bin of an event
+  /// \param PixelId  Pixel id as in the event message
+  /// \param TofUs    Time of flight in microseconds
+  /// \return false if the pixel has no flight path or the value is beyond
+  ///         the binned range
+  bool bin(uint32_t PixelId, uint32_t TofUs, uint32_t &Bin) const {
+    if (PixelId >= mBinsPerUs.size()) {
+      return false;
+    }
+    const float Scale = mBinsPerUs[PixelId];
+    if (Scale <= 0.0f) {
+      return false;
+    }
+    Bin = uint32_t(TofUs * Scale);
+    return Bin < mBins;
+  }
+
+  bool enabled() const { return mUnit != Tof and not mBinsPerUs.empty(); }
+  Unit unit() const { return mUnit; }
+
+private:
+  /// \brief h / m_n in m A / s
+  static constexpr double PlanckOverNeutronMass{3956.034};
+
+  std::vector<double> mFlightPath;  ///< L1 + L2 (m), 0 if unknown
+  std::vector<double> mTwoTheta;    ///< scattering angle (rad)
+  std::vector<float> mBinsPerUs;    ///< 0 if the pixel is not converted
+  uint32_t mBins{0};
+  Unit mUnit{Tof};
+};
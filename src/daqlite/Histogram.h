@@ -0,0 +1,220 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file Histogram.h
+///
+/// \brief N dimensional histogram with configurable axes and storage
+///
+/// The number of dimensions and the counter type are compile time parameters,
+/// the cell storage is one of the policies from HistogramStorage.h. Cells are
+/// stored row major, i.e. the last axis is contiguous. The plots use it as
+/// their data model and only convert cells to graph points or pixels.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <HistogramStorage.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// \class HistogramAxis
+/// \brief Uniform binning of one quantity in [Min, Max)
+class HistogramAxis {
+public:
+  enum Quantity { Pixel, X, Y, Z, Tof, PulseTime };
+
+  HistogramAxis() = default;
+
+  HistogramAxis(Quantity Type, size_t Bins, double Min, double Max)
+      : mQuantity(Type), mBins(Bins), mMin(Min), mMax(Max),
+        mScale((Max > Min) ? Bins / (Max - Min) : 0.0) {}
+
+  /// \brief axis with one bin per integer in [0, Bins), e.g. for pixels
+  HistogramAxis(Quantity Type, size_t Bins)
+      : HistogramAxis(Type, Bins, 0.0, double(Bins)) {}
+
+  Quantity quantity() const { return mQuantity; }
+  size_t bins() const { return mBins; }
+  double min() const { return mMin; }
+  double max() const { return mMax; }
+
+  /// \brief bin of a value
+  /// \return false if the value is outside the axis
+  bool bin(double Value, size_t &Bin) const {
+    if (not(Value >= mMin and Value < mMax)) {
+      return false;
+    }
+    Bin = std::min(size_t((Value - mMin) * mScale), mBins - 1);
+    return true;
+  }
+
+  /// \brief lower edge of a bin
+  double lowerEdge(size_t Bin) const { return mMin + Bin / mScale; }
+
+  /// \brief center value of a bin
+  double center(size_t Bin) const { return mMin + (Bin + 0.5) / mScale; }
+
+private:
+  Quantity mQuantity{Pixel};
+  size_t mBins{0};
+  double mMin{0};
+  double mMax{0};
+  double mScale{0};
+};
+
+template <size_t N, typename Counter = uint32_t,
+          template <typename> class Storage = DenseStorage>
+class Histogram {
+  static_assert(N > 0, "a histogram needs at least one axis");
+
+public:
+  using Axes = std::array<HistogramAxis, N>;
+  using Bins = std::array<size_t, N>;
+
+  Histogram() = default;
+
+  explicit Histogram(const Axes &Axis) { setAxes(Axis); }
+
+  /// \brief (re)define the axes, which also zeroes all cells
+  void setAxes(const Axes &Axis) {
+    mAxes = Axis;
+    size_t Cells = 1;
+    for (size_t d = N; d > 0; d--) {
+      mStrides[d - 1] = Cells;
+      Cells *= mAxes[d - 1].bins();
+    }
+    mStorage.resize(Cells);
+  }
+
+  const HistogramAxis &axis(size_t Dim) const { return mAxes[Dim]; }
+
+  /// \brief total number of cells
+  size_t size() const { return mStorage.size(); }
+
+  /// \brief distance between neighbouring cells along an axis
+  size_t stride(size_t Dim) const { return mStrides[Dim]; }
+
+  size_t index(const Bins &Bin) const {
+    size_t Index = 0;
+    for (size_t d = 0; d < N; d++) {
+      Index += Bin[d] * mStrides[d];
+    }
+    return Index;
+  }
+
+  Counter at(const Bins &Bin) const { return mStorage.get(index(Bin)); }
+  Counter at(size_t Index) const { return mStorage.get(Index); }
+
+  /// \brief add counts to a cell
+  /// \return the new value of the cell
+  Counter add(size_t Index, Counter Count = 1) {
+    return mStorage.add(Index, Count);
+  }
+
+  /// \brief remove counts from a cell that holds at least as many
+  /// \return the new value of the cell
+  Counter subtract(size_t Index, Counter Count) {
+    return mStorage.add(Index, Counter(-Count));
+  }
+
+  /// \brief remove contiguous counts from cells that hold at least as many,
+  /// e.g. a block of an expired time slice
+  /// \param Changed  called as Changed(Index, Old, New) for every cell that
+  ///                 lost counts
+  template <typename Value, typename Fn>
+  void subtract(size_t First, const Value *Counts, size_t Cells,
+                Fn &&Changed) {
+    for (size_t i = 0; i < Cells; i++) {
+      if (Counts[i] != 0) {
+        const Counter Count = Counter(Counts[i]);
+        const Counter New = mStorage.add(First + i, Counter(-Count));
+        Changed(First + i, Counter(New + Count), New);
+      }
+    }
+  }
+
+  /// \brief count one event with the given axis values
+  /// \return false if the event is outside the histogram
+  bool fill(const std::array<double, N> &Values, Counter Count = 1) {
+    size_t Index = 0;
+    for (size_t d = 0; d < N; d++) {
+      size_t Bin;
+      if (not mAxes[d].bin(Values[d], Bin)) {
+        return false;
+      }
+      Index += Bin * mStrides[d];
+    }
+    mStorage.add(Index, Count);
+    return true;
+  }
+
+  /// \brief count a batch of events with precomputed cell indices
+  ///
+  /// A plain loop: the indices of a message repeat, so the increments do not
+  /// vectorize without conflict detection, and for large histograms the
+  /// cache misses of the scattered cells dominate, which the out of order
+  /// core already overlaps (software prefetching gains nothing)
+  void fill(const uint32_t *Indices, size_t Events) {
+    for (size_t i = 0; i < Events; i++) {
+      mStorage.add(Indices[i], Counter(1));
+    }
+  }
+
+  /// \brief add a row major histogram of counts cell by cell
+  /// \param Counts   dense or sparse counts, e.g. a HistogramDelta, whose
+  ///                 forEach(First, Cells, Func) calls Func(Index, Count)
+  /// \param Changed  called as Changed(Index, Old, New) for every cell that
+  ///                 received counts, e.g. to keep statistics
+  /// \param Weight   multiplies the counts, see DecayScale
+  /// \param First    index in Counts of the count for cell 0, to merge a
+  ///                 slice of a larger histogram
+  template <typename Deltas, typename Fn>
+  void merge(const Deltas &Counts, Fn &&Changed, Counter Weight = Counter(1),
+             size_t First = 0) {
+    Counts.forEach(First, size(), [&](size_t i, auto Count) {
+      const Counter Added = Counter(Count) * Weight;
+      Counter New = mStorage.add(i, Added);
+      Changed(i, Counter(New - Added), New);
+    });
+  }
+
+  /// \brief multiply all cells by a factor
+  void scale(Counter Factor) {
+    for (size_t i = 0; i < size(); i++) {
+      const Counter Value = mStorage.get(i);
+      if (Value != 0) {
+        mStorage.add(i, Counter(Value * Factor - Value));
+      }
+    }
+  }
+
+  /// \brief sum of the counts along one axis, all other axes are summed over
+  std::vector<uint64_t> project(size_t Dim) const {
+    std::vector<uint64_t> Projection(mAxes[Dim].bins(), 0);
+    const size_t Stride = mStrides[Dim];
+    const size_t Bins = mAxes[Dim].bins();
+    mStorage.forEach([&](size_t Index, Counter Value) {
+      Projection[(Index / Stride) % Bins] += Value;
+    });
+    return Projection;
+  }
+
+  /// \brief call Fn(Index, Value) for all non-zero cells
+  template <typename Fn> void forEach(Fn &&Func) const {
+    mStorage.forEach(Func);
+  }
+
+  void clear() { mStorage.clear(); }
+
+  Storage<Counter> &storage() { return mStorage; }
+  const Storage<Counter> &storage() const { return mStorage; }
+
+private:
+  Axes mAxes;
+  std::array<size_t, N> mStrides{};
+  Storage<Counter> mStorage;
+};
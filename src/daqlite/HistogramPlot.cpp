@@ -30,7 +30,8 @@ using std::vector;
 
 HistogramPlot::HistogramPlot(Configuration &Config, ESSConsumer &Consumer)
     : AbstractPlot(PlotType::HISTOGRAM, Consumer)
-    , mConfig(Config) {
+    , mConfig(Config)
+    , mCursor(Consumer.histogramData().subscribe()) {
   // Register callback functions for events
   connect(this, &QCustomPlot::mouseMove, this, &HistogramPlot::showPointToolTip);
   setAttribute(Qt::WA_AlwaysShowToolTips);
@@ -39,7 +40,8 @@ HistogramPlot::HistogramPlot(Configuration &Config, ESSConsumer &Consumer)
 
   LogicalGeometry = new ESSGeometry(geom.XDim, geom.YDim, geom.ZDim, 1);
 
-  HistogramYAxisValues.resize(mConfig.mTOF.BinSize);
+  mHistogram.setAxes({HistogramAxis(HistogramAxis::Tof, mConfig.mTOF.BinSize, 0,
+                                    mConfig.mTOF.MaxValue)});
 
   // this will also allow rescaling the color scale by dragging/zooming
   setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
@@ -83,82 +85,120 @@ void HistogramPlot::setCustomParameters() {
 }
 
 void HistogramPlot::plotDetectorImage(bool) {
-  setCustomParameters();
-  mGraph->data()->clear();
+  // One point per bin, bins need both edges
+  const int Points = HistogramXAxisValues.empty()
+      ? 0
+      : std::min(mHistogram.size(), HistogramXAxisValues.size() - 1);
+
+  // Only reallocate the graph data when the number of bins changes,
+  // otherwise the sorted container is updated in place
+  auto Data = mGraph->data();
+  if (Data->size() != Points) {
+    Data->set(QVector<QCPGraphData>(Points), true);
+  }
 
-  for (unsigned int i = 0; i < HistogramYAxisValues.size(); i++) {
-    // calculate the middle x value of the bin to place the data point
-    auto binWidth = HistogramXAxisValues[i + 1] - HistogramXAxisValues[i];
-    auto middleXValue = HistogramXAxisValues[i] + binWidth / 2.0;
+  uint32_t MinX{UINT32_MAX};
+  uint32_t MaxX{0};
+  auto Point = Data->begin();
+  for (int i = 0; i < Points; i++, ++Point) {
+    const uint32_t Low = HistogramXAxisValues[i];
+    const uint32_t High = HistogramXAxisValues[i + 1];
+    MinX = std::min({MinX, Low, High});
+    MaxX = std::max({MaxX, Low, High});
 
-    double ScaledXValue = middleXValue / mConfig.mTOF.Scale;
+    // calculate the middle x value of the bin to place the data point
+    auto binWidth = High - Low;
+    auto middleXValue = Low + binWidth / 2.0;
 
-    mGraph->addData(ScaledXValue, HistogramYAxisValues[i]);
+    Point->key = middleXValue / mConfig.mTOF.Scale;
+    Point->value = mHistogram.at(i);
   }
 
   // yAxis->rescale();
-  if (mConfig.mTOF.AutoScaleX && !HistogramXAxisValues.empty()) {
-    double MaxX = *std::max_element(HistogramXAxisValues.begin(),
-                                    HistogramXAxisValues.end());
-
-    double MinX = *std::min_element(HistogramXAxisValues.begin(),
-                                    HistogramXAxisValues.end());
-
-    xAxis->setRange(MinX / mConfig.mTOF.Scale, MaxX / mConfig.mTOF.Scale * 1.05);
+  if (mConfig.mTOF.AutoScaleX && Points > 0) {
+    xAxis->setRange(double(MinX) / mConfig.mTOF.Scale,
+                    double(MaxX) / mConfig.mTOF.Scale * 1.05);
   }
-  if (mConfig.mTOF.AutoScaleY && !HistogramYAxisValues.empty()) {
-    auto MaxY = *std::max_element(HistogramYAxisValues.begin(),
-                                  HistogramYAxisValues.end());
-    yAxis->setRange(0, MaxY * 1.05);
+  if (mConfig.mTOF.AutoScaleY && Points > 0) {
+    yAxis->setRange(0, maxY() * 1.05);
   }
 
   replot();
 }
 
+double HistogramPlot::maxY() const {
+  if (mConfig.mPlot.RobustScale) {
+    return mStats.quantile(mConfig.mPlot.ScaleHighPercentile / 100.0);
+  }
+  return mStats.max();
+}
+
 void HistogramPlot::updateData() {
   // printf("addData (TOF) Histogram size %lu\n", Histogram.size());
   auto t2 = std::chrono::high_resolution_clock::now();
   std::chrono::duration<int64_t, std::nano> elapsed = t2 - t1;
 
+  // Always pull, the cursor keeps all epochs after it alive
+  auto Deltas = mConsumer.histogramData().pull(mCursor);
+
   // continue the the update only if we have data available from the consumer
-  if (mConsumer.getHistogramSize() == 0 or mConsumer.getTOFsSize() == 0) {
+  if (Deltas.empty() or mConsumer.getTOFsSize() == 0) {
     return;
   }
-
-  vector<uint32_t> YAxisValues = mConsumer.readResetHistogram();
   auto TofValues = mConsumer.getTofs();
 
   HistogramXAxisValues = TofValues;
 
-  if (YAxisValues.size() != HistogramXAxisValues.size() - 1) {
-    fmt::print("HistogramPlot::updateData() - Y axis values in not fit for x "
-               "axis values. Skip processing!\n");
-    return;
-  }
-
-  // Periodically clear the histogram data sets
-  //
-  int64_t nsBetweenClear = 1000000000LL * mConfig.mPlot.ClearEverySeconds;
-  if (mConfig.mPlot.ClearPeriodic and (elapsed.count() >= nsBetweenClear)) {
-    std::fill(HistogramYAxisValues.begin(), HistogramYAxisValues.end(), 0);
-    std::fill(HistogramXAxisValues.begin(), HistogramXAxisValues.end(), 0);
-    t1 = std::chrono::high_resolution_clock::now();
-  }
-
-  if (HistogramYAxisValues.size() < YAxisValues.size()) {
-    HistogramYAxisValues.resize(YAxisValues.size());
-  }
-
-  for (unsigned int i = 0; i < YAxisValues.size(); i++) {
-    HistogramYAxisValues[i] += YAxisValues[i];
+  for (const auto &Delta : Deltas) {
+    const auto &YAxisValues = *Delta;
+    if (YAxisValues.size() != HistogramXAxisValues.size() - 1) {
+      fmt::print("HistogramPlot::updateData() - Y axis values in not fit for x "
+                 "axis values. Skip processing!\n");
+      continue;
+    }
+
+    // A new binning restarts the histogram, the edges are only approximated
+    // by a uniform axis as the graph is drawn from the edges themselves
+    if (mHistogram.size() != YAxisValues.size()) {
+      mHistogram.setAxes({HistogramAxis(HistogramAxis::Tof, YAxisValues.size(),
+                                        HistogramXAxisValues.front(),
+                                        HistogramXAxisValues.back())});
+      mStats.clear();
+      mWindow.setup(YAxisValues.size(), mConfig.mPlot.RollingWindowSeconds,
+                    mConfig.mPlot.RollingSliceSeconds);
+    }
+
+    // Subtract the values that dropped out of the rolling window, or else
+    // periodically clear the histogram data sets
+    int64_t nsBetweenClear = 1000000000LL * mConfig.mPlot.ClearEverySeconds;
+    if (mWindow.enabled()) {
+      mWindow.advance(RollingWindow<>::Clock::now(),
+                      [this](size_t First, const uint64_t *Values, size_t Bins) {
+        mHistogram.subtract(First, Values, Bins,
+                            [this](size_t, uint64_t Old, uint64_t New) {
+                              mStats.update(Old, New);
+                            });
+      });
+      mWindow.add(YAxisValues);
+    } else if (mConfig.mPlot.ClearPeriodic and (elapsed.count() >= nsBetweenClear)) {
+      mHistogram.clear();
+      mStats.clear();
+      t1 = std::chrono::high_resolution_clock::now();
+      elapsed = elapsed.zero();
+    }
+
+    mHistogram.merge(YAxisValues, [this](size_t, uint64_t Old, uint64_t New) {
+      mStats.update(Old, New);
+    });
   }
 
-  plotDetectorImage(false);
   return;
 }
 
 void HistogramPlot::clearDetectorImage() {
-  std::fill(HistogramYAxisValues.begin(), HistogramYAxisValues.end(), 0);
+  mHistogram.clear();
+  mStats.clear();
+  mWindow.clear();
   plotDetectorImage(true);
 }
 
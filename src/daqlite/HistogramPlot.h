@@ -10,6 +10,10 @@
 #pragma once
 
 #include <AbstractPlot.h>
+#include <Histogram.h>
+#include <HistogramStorage.h>
+#include <RollingWindow.h>
+#include <ValueDistribution.h>
 
 #include <stdint.h>
 #include <vector>
@@ -27,12 +31,12 @@ public:
   /// \brief plot needs the configurable plotting options
   HistogramPlot(Configuration &Config, ESSConsumer &Consumer);
 
-  /// \brief adds histogram data, clears periodically then calls
+  /// \brief adds histogram data and clears periodically, drawing is left to
   /// plotDetectorImage()
   void updateData() override;
 
   /// \brief update plot based on (possibly dynamic) config settings
-  void setCustomParameters();
+  void setCustomParameters() override;
 
   ///
   void clearDetectorImage() override;
@@ -51,9 +55,26 @@ private:
   /// \brief configuration obtained from main()
   Configuration &mConfig;
 
-  std::vector<uint32_t> HistogramYAxisValues;
+  /// \brief values per time bin, 16 bit counters widening on overflow so
+  /// long runs of large da00 values do not wrap around
+  Histogram<1, uint64_t, AdaptiveStorage> mHistogram;
+
+  /// \brief time bin edges, one more than bins
   std::vector<uint32_t> HistogramXAxisValues;
 
+  /// \brief position in the da00 histogram deltas of the consumer
+  DeltaBus<uint64_t>::Cursor mCursor;
+
+  /// \brief running distribution of the bin values
+  ValueDistribution mStats;
+
+  /// \brief values of the last seconds, if showing a rolling window instead
+  /// of clearing periodically
+  RollingWindow<uint64_t> mWindow;
+
+  /// \brief upper Y value for autoscaling, the maximum or a high percentile
+  double maxY() const;
+
   /// \brief for calculating x, y, z from pixelid
   ESSGeometry *LogicalGeometry;
 
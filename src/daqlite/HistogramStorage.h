@@ -0,0 +1,444 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file HistogramStorage.h
+///
+/// \brief Cell storage policies for the Histogram engine
+///
+/// All storages map a linear cell index to a counter and share the same
+/// interface, so a Histogram can switch between them at compile time:
+///
+/// - DenseStorage: one counter per cell in a cache line aligned array, for
+///   small or well filled histograms and for direct rendering
+/// - BlockSparseStorage: counters in tiles of 64 cells allocated on first
+///   use, with an occupancy bitmap and a dense fallback, for large histograms
+///   where counts cluster (e.g. pixel x TOF) or that fill up slowly
+/// - HashedStorage: one hash map entry per non-zero cell, for very large and
+///   very sparse histograms
+/// - AdaptiveStorage: 16 bit counters, blocks of 64 cells are promoted to 32
+///   and 64 bit counters when a cell overflows by adding the high bits of
+///   their cells. Half the memory of 32 bit counters for large histograms,
+///   and no overflow in long runs
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+template <typename Counter> class DenseStorage {
+public:
+  static constexpr size_t CacheLine{64};
+
+  /// \brief allocate Cells zeroed counters
+  void resize(size_t Cells) {
+    constexpr size_t PerLine = std::max<size_t>(CacheLine / sizeof(Counter), 1);
+    mCells = Cells;
+
+    // Over-allocate by one cache line to be able to align the first cell
+    mStorage.assign(Cells + PerLine, Counter(0));
+    auto Address = reinterpret_cast<uintptr_t>(mStorage.data());
+    mOffset = ((CacheLine - Address % CacheLine) % CacheLine) / sizeof(Counter);
+  }
+
+  void clear() { std::fill(mStorage.begin(), mStorage.end(), Counter(0)); }
+
+  size_t size() const { return mCells; }
+
+  Counter get(size_t Index) const { return data()[Index]; }
+
+  /// \return the new value of the cell
+  Counter add(size_t Index, Counter Count) { return data()[Index] += Count; }
+
+  /// \brief call Fn(Index, Value) for all non-zero cells in index order
+  template <typename Fn> void forEach(Fn &&Func) const {
+    const Counter *Cells = data();
+    for (size_t i = 0; i < mCells; i++) {
+      if (Cells[i] != 0) {
+        Func(i, Cells[i]);
+      }
+    }
+  }
+
+  Counter *data() { return mStorage.data() + mOffset; }
+  const Counter *data() const { return mStorage.data() + mOffset; }
+
+private:
+  size_t mCells{0};
+  size_t mOffset{0};
+  std::vector<Counter> mStorage;
+};
+
+/// \brief Counters in tiles of 64 cells, allocated from a pool on first hit
+///
+/// A bitmap of the occupied tiles lets forEach() and clear() skip empty
+/// regions a word of 64 tiles at a time, so their cost scales with the
+/// occupied tiles rather than with the size of the histogram. Once more than
+/// half of the tiles are occupied the storage falls back to dense counters,
+/// saving the tile lookup, until it is cleared.
+template <typename Counter> class BlockSparseStorage {
+public:
+  static constexpr size_t BlockCells{64};
+
+  void resize(size_t Cells) {
+    mCells = Cells;
+    const size_t Blocks = (Cells + BlockCells - 1) / BlockCells;
+    mSlot.assign(Blocks, NoTile);
+    mOccupied.assign((Blocks + 63) / 64, 0);
+    mTiles.clear();
+    mDense = false;
+  }
+
+  /// \brief release all tiles, their memory is kept for reuse
+  void clear() {
+    if (mDense) {
+      std::fill(mSlot.begin(), mSlot.end(), NoTile);
+    } else {
+      forEachBlock([this](size_t Block) { mSlot[Block] = NoTile; });
+    }
+    std::fill(mOccupied.begin(), mOccupied.end(), 0);
+    mTiles.clear();
+    mDense = false;
+  }
+
+  size_t size() const { return mCells; }
+
+  Counter get(size_t Index) const {
+    if (mDense) {
+      return mTiles[Index];
+    }
+    const uint32_t Slot = mSlot[Index / BlockCells];
+    return (Slot == NoTile) ? Counter(0)
+                            : mTiles[Slot * BlockCells + Index % BlockCells];
+  }
+
+  Counter add(size_t Index, Counter Count) {
+    if (mDense) {
+      return mTiles[Index] += Count;
+    }
+    const size_t Block = Index / BlockCells;
+    if (mSlot[Block] == NoTile) {
+      allocate(Block);
+      if (mDense) {
+        return mTiles[Index] += Count;
+      }
+    }
+    return mTiles[mSlot[Block] * BlockCells + Index % BlockCells] += Count;
+  }
+
+  /// \brief call Fn(Index, Value) for all non-zero cells in index order
+  template <typename Fn> void forEach(Fn &&Func) const {
+    forEachTile([&](size_t First, const Counter *Cells, size_t Count) {
+      for (size_t i = 0; i < Count; i++) {
+        if (Cells[i] != 0) {
+          Func(First + i, Cells[i]);
+        }
+      }
+    });
+  }
+
+  /// \brief call Fn(First, Cells, Count) for all allocated tiles in index
+  /// order, with the Count counters of the cells from First on
+  template <typename Fn> void forEachTile(Fn &&Func) const {
+    forEachBlock([&](size_t Block) {
+      const size_t First = Block * BlockCells;
+      Func(First, tile(Block), std::min(BlockCells, mCells - First));
+    });
+  }
+
+  /// \brief forEachTile() for the tiles overlapping the cells [Begin, End),
+  /// in time proportional to the range
+  template <typename Fn>
+  void forEachTile(size_t Begin, size_t End, Fn &&Func) const {
+    End = std::min(End, mCells);
+    for (size_t Block = Begin / BlockCells; Block * BlockCells < End; Block++) {
+      if (mDense or mSlot[Block] != NoTile) {
+        const size_t First = Block * BlockCells;
+        Func(First, tile(Block), std::min(BlockCells, mCells - First));
+      }
+    }
+  }
+
+  /// \brief number of allocated tiles
+  size_t blocks() const {
+    size_t Blocks{0};
+    for (uint64_t Word : mOccupied) {
+      Blocks += __builtin_popcountll(Word);
+    }
+    return Blocks;
+  }
+
+  /// \brief true after falling back to dense counters
+  bool dense() const { return mDense; }
+
+private:
+  static constexpr uint32_t NoTile{UINT32_MAX};
+
+  /// \brief call Fn(Block) for all occupied blocks in order
+  template <typename Fn> void forEachBlock(Fn &&Func) const {
+    for (size_t w = 0; w < mOccupied.size(); w++) {
+      for (uint64_t Word = mOccupied[w]; Word != 0; Word &= Word - 1) {
+        Func(w * 64 + __builtin_ctzll(Word));
+      }
+    }
+  }
+
+  const Counter *tile(size_t Block) const {
+    return mTiles.data() + (mDense ? Block : mSlot[Block]) * BlockCells;
+  }
+
+  void allocate(size_t Block) {
+    mOccupied[Block / 64] |= uint64_t(1) << (Block % 64);
+    const size_t Tiles = mTiles.size() / BlockCells;
+    if (2 * (Tiles + 1) <= mSlot.size()) {
+      mSlot[Block] = Tiles;
+      mTiles.resize(mTiles.size() + BlockCells, Counter(0));
+      return;
+    }
+
+    // Occupancy is high, move the tiles into place in a dense array
+    std::vector<Counter> Dense(mSlot.size() * BlockCells, Counter(0));
+    for (size_t b = 0; b < mSlot.size(); b++) {
+      if (mSlot[b] != NoTile) {
+        std::copy_n(mTiles.begin() + mSlot[b] * BlockCells, BlockCells,
+                    Dense.begin() + b * BlockCells);
+      }
+    }
+    mTiles.swap(Dense);
+    std::iota(mSlot.begin(), mSlot.end(), 0);
+    std::fill(mOccupied.begin(), mOccupied.end(), ~uint64_t(0));
+    if (mSlot.size() % 64 != 0) {
+      mOccupied.back() = (uint64_t(1) << (mSlot.size() % 64)) - 1;
+    }
+    mDense = true;
+  }
+
+  size_t mCells{0};
+  bool mDense{false};
+
+  /// \brief tile of each block in mTiles, NoTile if unoccupied
+  std::vector<uint32_t> mSlot;
+
+  /// \brief one bit per block, set when its tile is allocated, all set
+  /// when dense
+  std::vector<uint64_t> mOccupied;
+
+  /// \brief pool of tiles, BlockCells counters each
+  std::vector<Counter> mTiles;
+};
+
+template <typename Counter> class HashedStorage {
+public:
+  void resize(size_t Cells) {
+    mCells = Cells;
+    mMap.clear();
+  }
+
+  void clear() { mMap.clear(); }
+
+  size_t size() const { return mCells; }
+
+  Counter get(size_t Index) const {
+    auto Cell = mMap.find(Index);
+    return Cell == mMap.end() ? Counter(0) : Cell->second;
+  }
+
+  Counter add(size_t Index, Counter Count) { return mMap[Index] += Count; }
+
+  /// \brief call Fn(Index, Value) for all non-zero cells, in no particular
+  /// order
+  template <typename Fn> void forEach(Fn &&Func) const {
+    for (const auto &[Index, Value] : mMap) {
+      if (Value != 0) {
+        Func(Index, Value);
+      }
+    }
+  }
+
+private:
+  size_t mCells{0};
+  std::unordered_map<size_t, Counter> mMap;
+};
+
+/// \brief Counters growing from 16 to 32 and 64 bits per block of 64 cells
+///
+/// The low 16 bits of all cells are kept in one array, a promoted block
+/// only adds the high bits of its cells: 16 more bits for 32 bit blocks and
+/// 48 (in 64) more bits for 64 bit blocks. So the narrow counters of a
+/// promoted block stay in use, and high bit blocks released by promotion to
+/// 64 bits are reused by the next promotion to 32 bits.
+/// \tparam Counter  Type of the values returned, an unsigned integer type of
+///                  at least 32 bits, uint64_t to never overflow
+template <typename Counter> class AdaptiveStorage {
+  static_assert(std::is_integral_v<Counter> and std::is_unsigned_v<Counter>,
+                "AdaptiveStorage counts unsigned integers");
+
+public:
+  static constexpr size_t BlockCells{64};
+
+  void resize(size_t Cells) {
+    mCells = Cells;
+    mLow.assign(Cells, 0);
+    mWidth.assign((Cells + BlockCells - 1) / BlockCells, Narrow);
+    mSlot.assign(mWidth.size(), 0);
+    mHigh16.clear();
+    mHigh16.shrink_to_fit();
+    mHigh48.clear();
+    mHigh48.shrink_to_fit();
+    mFree16.clear();
+  }
+
+  /// \brief zero all cells, the high bit blocks are kept for reuse
+  void clear() {
+    std::fill(mLow.begin(), mLow.end(), 0);
+    std::fill(mWidth.begin(), mWidth.end(), Narrow);
+    mFree16.resize(mHigh16.size());
+    std::iota(mFree16.begin(), mFree16.end(), 0);
+    mHigh48.clear();
+  }
+
+  size_t size() const { return mCells; }
+
+  Counter get(size_t Index) const {
+    const size_t Block = Index / BlockCells;
+    switch (mWidth[Block]) {
+    case Narrow:
+      return mLow[Index];
+    case Wide32:
+      return mLow[Index] |
+             Counter(mHigh16[mSlot[Block]][Index % BlockCells]) << 16;
+    default:
+      return Counter(mLow[Index] |
+                     mHigh48[mSlot[Block]][Index % BlockCells] << 16);
+    }
+  }
+
+  /// \brief add modulo the range of Counter, so that adding the complement
+  /// of a count subtracts it
+  /// \return the new value of the cell
+  Counter add(size_t Index, Counter Count) {
+    // The low 16 bits are in mLow for every block width, so an add that
+    // does not carry out of them is a plain 16 bit add. The block is only
+    // looked up for the return value, which the fills do not use
+    const uint32_t Low = uint32_t(mLow[Index]) + uint32_t(Count);
+    if (Count <= UINT16_MAX and Low <= UINT16_MAX) {
+      mLow[Index] = uint16_t(Low);
+      const size_t Block = Index / BlockCells;
+      return (mWidth[Block] == Narrow) ? Counter(Low) : get(Index);
+    }
+    return carry(Index, Count);
+  }
+
+  /// \brief call Fn(Index, Value) for all non-zero cells in index order
+  template <typename Fn> void forEach(Fn &&Func) const {
+    for (size_t i = 0; i < mCells; i++) {
+      Counter Value = get(i);
+      if (Value != 0) {
+        Func(i, Value);
+      }
+    }
+  }
+
+  /// \brief number of blocks with 32 and 64 bit counters
+  std::pair<size_t, size_t> promoted() const {
+    return {std::count(mWidth.begin(), mWidth.end(), Wide32),
+            std::count(mWidth.begin(), mWidth.end(), Wide64)};
+  }
+
+  /// \brief bytes held by the counters and the block table
+  size_t bytes() const {
+    return mLow.capacity() * sizeof(uint16_t) +
+           mHigh16.capacity() * sizeof(mHigh16[0]) +
+           mHigh48.capacity() * sizeof(mHigh48[0]) +
+           mWidth.capacity() * sizeof(Width) +
+           mSlot.capacity() * sizeof(uint32_t);
+  }
+
+private:
+  enum Width : uint8_t { Narrow, Wide32, Wide64 };
+
+  /// \brief add() that carries into the high bits, or a count that does
+  /// not fit in 16 bits, e.g. a subtraction, promoting the block if needed
+  Counter carry(size_t Index, Counter Count) {
+    const size_t Block = Index / BlockCells;
+
+    if (mWidth[Block] == Narrow) {
+      Counter New = Counter(mLow[Index] + Count);
+      if (New <= UINT16_MAX) {
+        mLow[Index] = uint16_t(New);
+        return New;
+      }
+      promote(Block, Wide32);
+    }
+
+    if (mWidth[Block] == Wide32) {
+      uint16_t &High = mHigh16[mSlot[Block]][Index % BlockCells];
+      Counter New = Counter((mLow[Index] | Counter(High) << 16) + Count);
+      if (uint64_t(New) <= UINT32_MAX) {
+        mLow[Index] = uint16_t(New);
+        High = uint16_t(New >> 16);
+        return New;
+      }
+      promote(Block, Wide64);
+    }
+
+    uint64_t &High = mHigh48[mSlot[Block]][Index % BlockCells];
+    Counter New = Counter((mLow[Index] | High << 16) + Count);
+    mLow[Index] = uint16_t(New);
+    High = uint64_t(New) >> 16;
+    return New;
+  }
+
+  /// \brief add the high bits of a block, the existing high bits are moved
+  /// and their block is released for reuse
+  void promote(size_t Block, Width To) {
+    const size_t First = Block * BlockCells;
+    const size_t Cells = std::min(BlockCells, mCells - First);
+
+    if (To == Wide32) {
+      if (mFree16.empty()) {
+        mHigh16.emplace_back();
+        mSlot[Block] = mHigh16.size() - 1;
+      } else {
+        mSlot[Block] = mFree16.back();
+        mFree16.pop_back();
+      }
+      mHigh16[mSlot[Block]].fill(0);
+    } else {
+      // 64 bit blocks are only released by clear()
+      mHigh48.emplace_back();
+      auto &High = mHigh48.back();
+      High.fill(0);
+      const auto &Old = mHigh16[mSlot[Block]];
+      std::copy(Old.begin(), Old.begin() + Cells, High.begin());
+      mFree16.push_back(mSlot[Block]);
+      mSlot[Block] = mHigh48.size() - 1;
+    }
+    mWidth[Block] = To;
+  }
+
+  size_t mCells{0};
+
+  /// \brief low 16 bits of all cells
+  std::vector<uint16_t> mLow;
+
+  /// \brief counter width of each block, and its index in mHigh16 or mHigh48
+  std::vector<Width> mWidth;
+  std::vector<uint32_t> mSlot;
+
+  /// \brief bits 16 - 31 of the cells of 32 bit blocks
+  std::vector<std::array<uint16_t, BlockCells>> mHigh16;
+
+  /// \brief bits 16 - 63 of the cells of 64 bit blocks
+  std::vector<std::array<uint64_t, BlockCells>> mHigh48;
+
+  /// \brief blocks of mHigh16 not used by any 32 bit block
+  std::vector<uint32_t> mFree16;
+};
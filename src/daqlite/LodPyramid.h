@@ -0,0 +1,204 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file LodPyramid.h
+///
+/// \brief Level-of-detail (mip) pyramid for large 2D detector images
+///
+/// Level 0 holds the full resolution image. Each following level halves both
+/// dimensions and stores either the sum or the maximum of the (up to) four
+/// cells below it. The pyramid is maintained incrementally: setting a level 0
+/// cell only touches one cell per level.
+///
+/// Every level is a (Y, X) Histogram of unsigned integer counts in one of
+/// the storages of HistogramStorage.h, by default 16 bit counters that widen
+/// per block, and are converted when colorizing. That is a quarter of the memory of double
+/// cells for the mostly low counts of large detector images.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <Histogram.h>
+#include <HistogramStorage.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+template <typename T, template <typename> class Storage = AdaptiveStorage>
+class LodPyramid {
+  static_assert(std::is_integral_v<T> and std::is_unsigned_v<T>,
+                "LodPyramid counts unsigned integers");
+
+public:
+  /// \brief How four cells are combined into one cell on the next level
+  enum Reduction { Sum, Max };
+
+  LodPyramid() = default;
+
+  /// \brief (Re)allocate the pyramid for a Width x Height level 0 image
+  void resize(int Width, int Height, Reduction Mode) {
+    mMode = Mode;
+    mLevels.clear();
+
+    int W = std::max(Width, 1);
+    int H = std::max(Height, 1);
+    while (true) {
+      mLevels.push_back({W, H, {}});
+      mLevels.back().Cells.setAxes({HistogramAxis(HistogramAxis::Y, H),
+                                    HistogramAxis(HistogramAxis::X, W)});
+      if (W == 1 && H == 1) {
+        break;
+      }
+      W = (W + 1) / 2;
+      H = (H + 1) / 2;
+    }
+  }
+
+  /// \brief Zero all levels
+  void clear() {
+    for (auto &Level : mLevels) {
+      Level.Cells.clear();
+    }
+  }
+
+  /// \brief Set a level 0 cell and propagate the change upwards
+  void set(int X, int Y, T Value) {
+    T Old = mLevels[0].at(X, Y);
+    if (Old == Value) {
+      return;
+    }
+    mLevels[0].set(X, Y, Old, Value);
+
+    for (size_t L = 1; L < mLevels.size(); L++) {
+      X /= 2;
+      Y /= 2;
+      const T Parent = mLevels[L].at(X, Y);
+
+      // Sums are updated modulo the range of T, so shrinking values wrap
+      // back into range
+      if (mMode == Sum) {
+        mLevels[L].set(X, Y, Parent, T(Parent - Old + Value));
+        continue;
+      }
+
+      // Max: growing values can only raise the parent, shrinking values
+      // require the parent to be recomputed from its children
+      T NewParent = (Value >= Old) ? std::max(Parent, Value)
+                                   : maxOfChildren(L, X, Y);
+      if (NewParent == Parent) {
+        return;
+      }
+      mLevels[L].set(X, Y, Parent, NewParent);
+      Old = Parent;
+      Value = NewParent;
+    }
+  }
+
+  /// \brief Multiply all level 0 cells by a positive factor, rounding to
+  /// the nearest count, and rebuild the other levels from them
+  void scale(double Factor) {
+    Level &Image = mLevels[0];
+    for (size_t i = 0; i < Image.Cells.size(); i++) {
+      const T Value = Image.Cells.at(i);
+      if (Value != 0) {
+        Image.Cells.add(i, T(T(std::llround(Value * Factor)) - Value));
+      }
+    }
+
+    // The levels are rebuilt rather than scaled, or else their rounding
+    // would differ from the one of the cells below
+    for (size_t L = 1; L < mLevels.size(); L++) {
+      Level &Reduced = mLevels[L];
+      Reduced.Cells.clear();
+      for (int Y = 0; Y < Reduced.Height; Y++) {
+        for (int X = 0; X < Reduced.Width; X++) {
+          T Value = (mMode == Sum) ? sumOfChildren(L, X, Y)
+                                   : maxOfChildren(L, X, Y);
+          Reduced.set(X, Y, T(0), Value);
+        }
+      }
+    }
+  }
+
+  /// \brief Add to a level 0 cell and propagate the change upwards
+  void add(int X, int Y, T Delta) { set(X, Y, mLevels[0].at(X, Y) + Delta); }
+
+  /// \brief Value of a cell on a given level
+  T at(int Level, int X, int Y) const { return mLevels[Level].at(X, Y); }
+
+  /// \brief Row major cells of a given level
+  const Storage<T> &cells(int Level) const {
+    return mLevels[Level].Cells.storage();
+  }
+
+  int levels() const { return mLevels.size(); }
+  int width(int Level) const { return mLevels[Level].Width; }
+  int height(int Level) const { return mLevels[Level].Height; }
+  Reduction mode() const { return mMode; }
+
+  /// \brief Select the coarsest level that still has at least one cell per
+  /// screen pixel for the visible part of the image
+  ///
+  /// \param CellsX  Visible level 0 cells along X
+  /// \param CellsY  Visible level 0 cells along Y
+  /// \param PixelsX Screen pixels available along X
+  /// \param PixelsY Screen pixels available along Y
+  int selectLevel(double CellsX, double CellsY, int PixelsX,
+                  int PixelsY) const {
+    double Ratio = std::max(CellsX / std::max(PixelsX, 1),
+                            CellsY / std::max(PixelsY, 1));
+    if (Ratio <= 1.0) {
+      return 0;
+    }
+    int Level = int(std::floor(std::log2(Ratio)));
+    return std::clamp(Level, 0, levels() - 1);
+  }
+
+private:
+  struct Level {
+    int Width;
+    int Height;
+    Histogram<2, T, Storage> Cells;
+
+    T at(int X, int Y) const { return Cells.at(size_t(Y) * Width + X); }
+
+    /// \brief replace the value Old of a cell by New
+    void set(int X, int Y, T Old, T New) {
+      Cells.add(size_t(Y) * Width + X, T(New - Old));
+    }
+  };
+
+  T sumOfChildren(size_t L, int X, int Y) const {
+    const Level &Child = mLevels[L - 1];
+    int X1 = std::min(2 * X + 1, Child.Width - 1);
+    int Y1 = std::min(2 * Y + 1, Child.Height - 1);
+
+    T Sum = 0;
+    for (int Yc = 2 * Y; Yc <= Y1; Yc++) {
+      for (int Xc = 2 * X; Xc <= X1; Xc++) {
+        Sum += Child.at(Xc, Yc);
+      }
+    }
+    return Sum;
+  }
+
+  T maxOfChildren(size_t L, int X, int Y) const {
+    const Level &Child = mLevels[L - 1];
+    int X1 = std::min(2 * X + 1, Child.Width - 1);
+    int Y1 = std::min(2 * Y + 1, Child.Height - 1);
+
+    T Max = Child.at(2 * X, 2 * Y);
+    for (int Yc = 2 * Y; Yc <= Y1; Yc++) {
+      for (int Xc = 2 * X; Xc <= X1; Xc++) {
+        Max = std::max(Max, Child.at(Xc, Yc));
+      }
+    }
+    return Max;
+  }
+
+  Reduction mMode{Max};
+  std::vector<Level> mLevels;
+};
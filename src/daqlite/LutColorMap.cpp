@@ -0,0 +1,160 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file LutColorMap.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include <LutColorMap.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+void LutColorMap::setCells(const double *Cells, size_t KeyStride,
+                           size_t ValueStride) {
+  mDoubleCells = Cells;
+  mCountCells = nullptr;
+  mAdaptiveCells = nullptr;
+  mKeyStride = KeyStride;
+  mValueStride = ValueStride;
+  mMapImageInvalidated = true;
+}
+
+void LutColorMap::setCells(const uint32_t *Cells, size_t KeyStride,
+                           size_t ValueStride) {
+  mDoubleCells = nullptr;
+  mCountCells = Cells;
+  mAdaptiveCells = nullptr;
+  mKeyStride = KeyStride;
+  mValueStride = ValueStride;
+  mMapImageInvalidated = true;
+}
+
+void LutColorMap::setCells(const AdaptiveStorage<uint64_t> &Cells,
+                           size_t First, size_t KeyStride,
+                           size_t ValueStride) {
+  mDoubleCells = nullptr;
+  mCountCells = nullptr;
+  mAdaptiveCells = &Cells;
+  mFirst = First;
+  mKeyStride = KeyStride;
+  mValueStride = ValueStride;
+  mMapImageInvalidated = true;
+}
+
+const std::vector<float> &LutColorMap::logTable() {
+  static const std::vector<float> Table = []() {
+    std::vector<float> Logs(LogTableSize);
+    Logs[0] = -INFINITY;
+    for (uint32_t i = 1; i < LogTableSize; i++) {
+      Logs[i] = std::log(double(i));
+    }
+    return Logs;
+  }();
+  return Table;
+}
+
+void LutColorMap::compileLut() {
+  std::vector<double> Ramp(LutSize);
+  std::iota(Ramp.begin(), Ramp.end(), 0.0);
+
+  mLut.resize(LutSize);
+  mGradient.colorize(Ramp.data(), QCPRange(0, LutSize - 1), mLut.data(),
+                     LutSize);
+  mLutGradient = mGradient;
+  mLutValid = true;
+}
+
+template <typename Reader>
+void LutColorMap::colorize(const Reader &Cell, QImage &Image) {
+  const int KeySize = mMapData->keySize();
+  const int ValueSize = mMapData->valueSize();
+  const bool Log = mDataScaleType == QCPAxis::stLogarithmic;
+
+  // Map a cell value to a LUT position with one multiply-add
+  double Offset = mDataRange.lower;
+  double Span = mDataRange.upper - mDataRange.lower;
+  if (Log) {
+    Offset = std::log(mDataRange.lower);
+    Span = std::log(mDataRange.upper) - Offset;
+  }
+  const double Scale = (Span > 0) ? (LutSize - 1) / Span : 0.0;
+  const double MaxIndex = LutSize - 1;
+
+  for (int v = 0; v < ValueSize; v++) {
+    // QImage counts scanlines from the top, value indexes from the bottom
+    QRgb *Pixels = reinterpret_cast<QRgb *>(Image.scanLine(ValueSize - 1 - v));
+    const size_t Line = v * mValueStride;
+
+    if (Log) {
+      for (int k = 0; k < KeySize; k++) {
+        double Position = (logOf(Cell(Line + k * mKeyStride)) - Offset) * Scale;
+        Pixels[k] = mLut[int(std::clamp(Position, 0.0, MaxIndex))];
+      }
+    } else {
+      for (int k = 0; k < KeySize; k++) {
+        double Position = (Cell(Line + k * mKeyStride) - Offset) * Scale;
+        Pixels[k] = mLut[int(std::clamp(Position, 0.0, MaxIndex))];
+      }
+    }
+  }
+}
+
+void LutColorMap::updateMapImage() {
+  QCPAxis *KeyAxis = mKeyAxis.data();
+  bool External = mDoubleCells != nullptr or mCountCells != nullptr or
+                  mAdaptiveCells != nullptr;
+  if (not External or not KeyAxis or
+      KeyAxis->orientation() != Qt::Horizontal) {
+    QCPColorMap::updateMapImage();
+    return;
+  }
+  if (mMapData->isEmpty()) {
+    return;
+  }
+
+  // Gradient changes only invalidate the LUT
+  if (not mLutValid or not(mLutGradient == mGradient)) {
+    compileLut();
+  }
+
+  const QImage::Format Format = QImage::Format_ARGB32_Premultiplied;
+  const int KeySize = mMapData->keySize();
+  const int ValueSize = mMapData->valueSize();
+
+  // Small maps are oversampled like in QCPColorMap, so cells stay sharp
+  const int KeyFactor = mInterpolate ? 1 : int(1.0 + 100.0 / KeySize);
+  const int ValueFactor = mInterpolate ? 1 : int(1.0 + 100.0 / ValueSize);
+  const bool Oversample = KeyFactor > 1 or ValueFactor > 1;
+
+  QImage *Target = Oversample ? &mUndersampledMapImage : &mMapImage;
+  if (Target->size() != QSize(KeySize, ValueSize)) {
+    *Target = QImage(QSize(KeySize, ValueSize), Format);
+  }
+
+  // Adaptive width counts are widened cell by cell while colorizing
+  if (mDoubleCells) {
+    const double *Cells = mDoubleCells;
+    colorize([Cells](size_t i) { return Cells[i]; }, *Target);
+  } else if (mCountCells) {
+    const uint32_t *Cells = mCountCells;
+    colorize([Cells](size_t i) { return Cells[i]; }, *Target);
+  } else {
+    const AdaptiveStorage<uint64_t> *Cells = mAdaptiveCells;
+    const size_t First = mFirst;
+    colorize([Cells, First](size_t i) { return Cells->get(First + i); },
+             *Target);
+  }
+
+  if (Oversample) {
+    mMapImage = mUndersampledMapImage.scaled(KeySize * KeyFactor,
+                                             ValueSize * ValueFactor,
+                                             Qt::IgnoreAspectRatio,
+                                             Qt::FastTransformation);
+  } else if (not mUndersampledMapImage.isNull()) {
+    mUndersampledMapImage = QImage();
+  }
+
+  mMapImageInvalidated = false;
+}
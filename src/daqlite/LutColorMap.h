@@ -0,0 +1,94 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file LutColorMap.h
+///
+/// \brief QCPColorMap colorizing histogram cells through a cached color LUT
+///
+/// QCPColorMap colorizes its own double cells through QCPColorGradient, which
+/// takes a logarithm per cell and frame for logarithmic color scales. This
+/// subclass reads the cells directly from the plot's histogram storage,
+/// compiles the gradient into a lookup table once per gradient change and uses
+/// a precomputed logarithm table for integer counts.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <HistogramStorage.h>
+
+#include <QPlot/qcustomplot/qcustomplot.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class LutColorMap : public QCPColorMap {
+public:
+  LutColorMap(QCPAxis *KeyAxis, QCPAxis *ValueAxis)
+      : QCPColorMap(KeyAxis, ValueAxis) {}
+
+  /// \brief colorize from external cells instead of the QCPColorMapData
+  /// cells. The size and coordinate range are still taken from data().
+  ///
+  /// Cell (key k, value v) is read from Cells[k * KeyStride + v * ValueStride]
+  void setCells(const double *Cells, size_t KeyStride, size_t ValueStride);
+
+  /// \brief as above for integer counts
+  void setCells(const uint32_t *Cells, size_t KeyStride, size_t ValueStride);
+
+  /// \brief as above for adaptive width counts, starting at cell First
+  void setCells(const AdaptiveStorage<uint64_t> &Cells, size_t First,
+                size_t KeyStride, size_t ValueStride);
+
+  /// \brief the cells changed, recolor before the next draw
+  void cellsChanged() { mMapImageInvalidated = true; }
+
+protected:
+  /// \brief colorize the external cells through the LUT
+  void updateMapImage() override;
+
+private:
+  /// \brief Number of colors in the LUT
+  static constexpr int LutSize{1024};
+
+  /// \brief Integer counts below this have a precomputed logarithm
+  static constexpr uint32_t LogTableSize{1 << 16};
+
+  /// \brief ln(i) for i in [0, LogTableSize), shared by all color maps
+  static const std::vector<float> &logTable();
+
+  static double logOf(uint32_t Value) {
+    return Value < LogTableSize ? logTable()[Value] : std::log(double(Value));
+  }
+
+  static double logOf(uint64_t Value) {
+    return Value < LogTableSize ? logTable()[Value] : std::log(double(Value));
+  }
+
+  static double logOf(double Value) {
+    uint32_t Count = uint32_t(Value);
+    if (Count == Value and Count < LogTableSize) {
+      return logTable()[Count];
+    }
+    return std::log(Value);
+  }
+
+  /// \brief sample the current gradient into mLut
+  void compileLut();
+
+  /// \brief colorize the cells returned by Cell(Index)
+  template <typename Reader> void colorize(const Reader &Cell, QImage &Image);
+
+  const double *mDoubleCells{nullptr};
+  const uint32_t *mCountCells{nullptr};
+  const AdaptiveStorage<uint64_t> *mAdaptiveCells{nullptr};
+  size_t mFirst{0};
+  size_t mKeyStride{1};
+  size_t mValueStride{1};
+
+  /// \brief compiled colors and the gradient they were compiled from
+  std::vector<QRgb> mLut;
+  QCPColorGradient mLutGradient;
+  bool mLutValid{false};
+};
@@ -12,6 +12,7 @@
 #include <CustomAMOR2DTOFPlot.h>
 #include <CustomTofPlot.h>
 #include <HistogramPlot.h>
+#include <PulsePlot.h>
 #include <WorkerThread.h>
 
 #include <QApplication>
@@ -36,6 +37,10 @@ MainWindow::MainWindow(const Configuration &Config, WorkerThread *Worker, QWidge
   ui->setupUi(this);
   setupPlots();
 
+  for (auto &Plot : Plots) {
+    mScheduler.addPlot(Plot.get(), mConfig.mPlot.RefreshRate);
+  }
+
   ui->lblDescriptionText->setText(mConfig.mPlot.PlotTitle.c_str());
   ui->lblEventRateText->setText("0");
 
@@ -131,6 +136,20 @@ void MainWindow::setupPlots() {
 
   }
 
+  else if (Type == PlotType::PULSES) {
+    Plots.push_back(std::make_unique<PulsePlot>(
+        mConfig, mWorker->getConsumer()));
+
+    ui->gridLayout->addWidget(Plots.back().get(), 0, 0, 1, 1);
+
+    // Hide irrelevant buttons for pulses
+    ui->pushButtonGradient->setVisible(false);
+    ui->pushButtonInvert->setVisible(false);
+    ui->lblGradientText->setVisible(false);
+    ui->lblGradient->setVisible(false);
+
+  }
+
   else if (Type == PlotType::PIXELS) {
 
     // Always create the XY plot
@@ -156,8 +175,9 @@ void MainWindow::setupPlots() {
     throw(std::runtime_error("No valid plot type specified"));
   }
 
-  // Autoscale buttons are only relevant for TOF and HISTOGRAM
-  if (Plots[0]->getPlotType() == PlotType::TOF || Plots[0]->getPlotType() == PlotType::HISTOGRAM) {
+  // Autoscale buttons are only relevant for TOF, HISTOGRAM and PULSES
+  if (Plots[0]->getPlotType() == PlotType::TOF || Plots[0]->getPlotType() == PlotType::HISTOGRAM ||
+      Plots[0]->getPlotType() == PlotType::PULSES) {
     ui->pushButtonAutoScaleX->setVisible(true);
     ui->lblAutoScaleXText->setVisible(true);
     ui->lblAutoScaleX->setVisible(true);
@@ -176,26 +196,25 @@ void MainWindow::startKafkaConsumerThread() {
   qRegisterMetaType<int>("int&");
   connect(mWorker, &WorkerThread::resultReady, this,
           &MainWindow::handleKafkaData);
+  mScheduler.start();
 }
 
 // SLOT
-void MainWindow::handleKafkaData(int ElapsedCountMS) {
+void MainWindow::handleKafkaData(int) {
   auto &Consumer = mWorker->getConsumer();
 
-  uint64_t EventRate = Consumer.getEventCount() * 1000ULL / ElapsedCountMS;
-  uint64_t EventAccept = Consumer.getEventAccept() * 1000ULL / ElapsedCountMS;
-  uint64_t EventDiscardRate = Consumer.getEventDiscard() * 1000ULL / ElapsedCountMS;
+  // Rates over the last seconds, from the never reset consumer counters
+  mRates.update(Consumer.stats());
+  uint64_t EventRate = mRates.rate(ConsumerStats::Events);
+  uint64_t EventAccept = mRates.rate(ConsumerStats::EventsAccepted);
+  uint64_t EventDiscardRate = mRates.rate(ConsumerStats::DiscardPixel);
 
   ui->lblEventRateText->setText(QString::number(EventRate));
   ui->lblAcceptRateText->setText(QString::number(EventAccept));
   ui->lblDiscardedPixelsText->setText(QString::number(EventDiscardRate));
   ui->lblBinSizeText->setText(QString::number(mConfig.mTOF.BinSize) + " " + QString::number(mCount));
 
-  for (auto &Plot : Plots) {
-    Plot->updateData();
-  }
-  Consumer.gotEventRequest();
-
+  // Plots are updated by mScheduler
 
   mCount += 1;
 }
@@ -227,7 +246,8 @@ void MainWindow::updateGradientLabel() {
 
 /// \brief Autoscale is only relevant for TOF
 void MainWindow::updateAutoScaleLabels() {
-  if (Plots[0]->getPlotType() ==  PlotType::TOF || Plots[0]->getPlotType() ==  PlotType::HISTOGRAM) {
+  if (Plots[0]->getPlotType() ==  PlotType::TOF || Plots[0]->getPlotType() ==  PlotType::HISTOGRAM ||
+      Plots[0]->getPlotType() == PlotType::PULSES) {
     if (mConfig.mTOF.AutoScaleX) {
       ui->lblAutoScaleXText->setText(QString::fromStdString("on"));
     } else {
@@ -245,6 +265,15 @@ void MainWindow::updateAutoScaleLabels() {
 // toggle the log scale flag
 void MainWindow::handleLogButton() {
   mConfig.mPlot.LogScale = not mConfig.mPlot.LogScale;
+  applyCustomParameters();
+}
+
+void MainWindow::applyCustomParameters() {
+  // Only the color/axis mapping changes, the histogram data is untouched
+  for (auto &Plot : Plots) {
+    Plot->setCustomParameters();
+    Plot->replot();
+  }
 }
 
 // toggle the invert gradient flag (irrelevant for TOF)
@@ -252,12 +281,14 @@ void MainWindow::handleInvertButton() {
   if (Plots[0]->getPlotType() ==  PlotType::PIXELS || Plots[0]->getPlotType() ==  PlotType::TOF2D) {
     mConfig.mPlot.InvertGradient = not mConfig.mPlot.InvertGradient;
     updateGradientLabel();
+    applyCustomParameters();
   }
 }
 
 // toggle the auto scale x button
 void MainWindow::handleAutoScaleXButton() {
-  if (Plots[0]->getPlotType() ==  PlotType::TOF || Plots[0]->getPlotType() ==  PlotType::HISTOGRAM) {
+  if (Plots[0]->getPlotType() ==  PlotType::TOF || Plots[0]->getPlotType() ==  PlotType::HISTOGRAM ||
+      Plots[0]->getPlotType() == PlotType::PULSES) {
     mConfig.mTOF.AutoScaleX = not mConfig.mTOF.AutoScaleX;
     updateAutoScaleLabels();
   }
@@ -265,37 +296,39 @@ void MainWindow::handleAutoScaleXButton() {
 
 // toggle the auto scale y button
 void MainWindow::handleAutoScaleYButton() {
-  if (Plots[0]->getPlotType() ==  PlotType::TOF || Plots[0]->getPlotType() ==  PlotType::HISTOGRAM) {
+  if (Plots[0]->getPlotType() ==  PlotType::TOF || Plots[0]->getPlotType() ==  PlotType::HISTOGRAM ||
+      Plots[0]->getPlotType() == PlotType::PULSES) {
     mConfig.mTOF.AutoScaleY = not mConfig.mTOF.AutoScaleY;
     updateAutoScaleLabels();
   }
 }
 
 void MainWindow::handleGradientButton() {
+  // All plots of the window share the gradient, so advance it only once
+  auto &Plot = Plots[0];
 
-  for (auto &Plot : Plots) {
-    if (Plot->getPlotType() ==  PlotType::PIXELS) {
-
-      Custom2DPlot *Plot2D = dynamic_cast<Custom2DPlot *>(Plot.get());
+  if (Plot->getPlotType() ==  PlotType::PIXELS) {
 
-      /// \todo unnecessary code here could be part of the object since it has
-      /// the config at construction
-      mConfig.mPlot.ColorGradient =
-          Plot2D->getNextColorGradient(mConfig.mPlot.ColorGradient);
+    Custom2DPlot *Plot2D = dynamic_cast<Custom2DPlot *>(Plot.get());
 
-    } else if (Plot->getPlotType() != PlotType::TOF2D) {
+    /// \todo unnecessary code here could be part of the object since it has
+    /// the config at construction
+    mConfig.mPlot.ColorGradient =
+        Plot2D->getNextColorGradient(mConfig.mPlot.ColorGradient);
 
-      CustomAMOR2DTOFPlot *PlotTOF2D =
-          dynamic_cast<CustomAMOR2DTOFPlot *>(Plot.get());
+  } else if (Plot->getPlotType() == PlotType::TOF2D) {
 
-      mConfig.mPlot.ColorGradient =
-          PlotTOF2D->getNextColorGradient(mConfig.mPlot.ColorGradient);
+    CustomAMOR2DTOFPlot *PlotTOF2D =
+        dynamic_cast<CustomAMOR2DTOFPlot *>(Plot.get());
 
-    } else {
-      return;
-    }
+    mConfig.mPlot.ColorGradient =
+        PlotTOF2D->getNextColorGradient(mConfig.mPlot.ColorGradient);
 
-    Plot->plotDetectorImage(true);
+  } else {
+    return;
   }
+
+  // Gradient changes only recompile the color LUTs
   updateGradientLabel();
+  applyCustomParameters();
 }
@@ -9,6 +9,9 @@
 #pragma once
 
 #include <Configuration.h>
+#include <ConsumerStats.h>
+#include <RefreshScheduler.h>
+
 #include <QMainWindow>
 
 #include <stddef.h>
@@ -42,6 +45,9 @@ public:
   /// \brief update GUI label text
   void updateAutoScaleLabels();
 
+  /// \brief apply toggled display settings to all plots
+  void applyCustomParameters();
+
 public slots:
   void handleExitButton();
   void handleClearButton();
@@ -63,6 +69,12 @@ private:
   // Pointer to worker thread
   WorkerThread *mWorker;
 
+  /// \brief Refreshes the plots, each with its own cadence
+  RefreshScheduler mScheduler;
+
   /// \brief Number of updates data deliveries so far
   size_t mCount;
+
+  /// \brief Event rates shown in the window
+  RateEstimator mRates;
 };
@@ -0,0 +1,93 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file PackedEvents.h
+///
+/// \brief (pixel, TOF bin) event tuples packed into one word each
+///
+/// The decode kernel stages the events of a message before adding them to
+/// the histograms. A TOF bin needs 9 - 12 bits and a pixel index 22 - 23 bits
+/// even for the largest detectors, so both fit into one 32 bit word:
+/// Pixel << TofBits | TofBin. Only if they do not, 64 bit words are used.
+/// That is half the memory of staging 64 bit cell indices or a pair of
+/// 32 bit vectors.
+///
+/// Packing and unpacking are a shift and a mask per event, the width check
+/// is done once per message.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class PackedEvents {
+public:
+  PackedEvents() = default;
+
+  /// \param Pixels   Number of pixel indices, 0 to Pixels - 1
+  /// \param TofBins  Number of TOF bins
+  PackedEvents(size_t Pixels, size_t TofBins)
+      : mTofBits(bits(TofBins)), mTofMask((uint64_t(1) << mTofBits) - 1),
+        mWide(bits(Pixels) + mTofBits > 32) {}
+
+  /// \brief number of bits to hold the values 0 to Count - 1
+  static uint32_t bits(size_t Count) {
+    uint32_t Bits = 0;
+    while (Bits < 64 and (uint64_t(1) << Bits) < Count) {
+      Bits++;
+    }
+    return Bits;
+  }
+
+  /// \brief true if the events need 64 bit words
+  bool wide() const { return mWide; }
+
+  size_t size() const { return mWide ? mWords64.size() : mWords32.size(); }
+  bool empty() const { return size() == 0; }
+
+  void reserve(size_t Events) {
+    mWide ? mWords64.reserve(Events) : mWords32.reserve(Events);
+  }
+
+  void clear() {
+    mWords32.clear();
+    mWords64.clear();
+  }
+
+  /// \brief add an event, the pixel index and TOF bin must be in range
+  void push(uint32_t Pixel, uint32_t TofBin) {
+    if (mWide) {
+      mWords64.push_back((uint64_t(Pixel) << mTofBits) | TofBin);
+    } else {
+      mWords32.push_back((Pixel << mTofBits) | TofBin);
+    }
+  }
+
+  /// \brief call Func(Pixel, TofBin) for all events, in order
+  template <typename Fn> void forEach(Fn &&Func) const {
+    if (mWide) {
+      unpack(mWords64, Func);
+    } else {
+      unpack(mWords32, Func);
+    }
+  }
+
+private:
+  template <typename Word, typename Fn>
+  void unpack(const std::vector<Word> &Words, Fn &Func) const {
+    const uint32_t Shift = mTofBits;
+    const Word Mask = Word(mTofMask);
+    for (const Word W : Words) {
+      Func(uint32_t(W >> Shift), uint32_t(W & Mask));
+    }
+  }
+
+  uint32_t mTofBits{0};
+  uint64_t mTofMask{0};
+  bool mWide{false};
+
+  std::vector<uint32_t> mWords32;
+  std::vector<uint64_t> mWords64;
+};
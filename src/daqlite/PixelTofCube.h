@@ -0,0 +1,137 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file PixelTofCube.h
+///
+/// \brief Thread safe (pixel, TOF bin) histogram for per pixel TOF spectra
+///
+/// Counters are 16 bit in blocks of 64 TOF bins that are only allocated once
+/// a pixel sees counts in that TOF range, which keeps the cube in memory for
+/// large detectors. Counters wrapping around are promoted to an overflow map
+/// holding the number of wraps, so counts are still exact.
+///
+/// When most blocks have counts the storage turns dense, so the configuration
+/// limits pixels x TOF bins to MaxBytes of 16 bit counters.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <Histogram.h>
+#include <HistogramStorage.h>
+#include <PackedEvents.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class PixelTofCube {
+public:
+  /// \brief memory ceiling of the counters if they are all allocated
+  static constexpr size_t MaxBytes{size_t(1) << 30};
+
+  /// \brief allocate (and zero) the cube
+  /// \param Pixels   Number of pixels, pixel index 0 is pixel id 1
+  /// \param TofBins  Number of TOF bins per pixel
+  void resize(size_t Pixels, size_t TofBins) {
+    std::lock_guard<std::mutex> Lock(mMutex);
+    mCounts.setAxes({HistogramAxis(HistogramAxis::Pixel, Pixels),
+                     HistogramAxis(HistogramAxis::Tof, TofBins)});
+    mOverflow.clear();
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> Lock(mMutex);
+    mCounts.clear();
+    mOverflow.clear();
+  }
+
+  size_t pixels() const { return mCounts.axis(0).bins(); }
+  size_t tofBins() const { return mCounts.axis(1).bins(); }
+
+  /// \brief cell index of a pixel index and TOF bin
+  size_t cell(size_t Pixel, size_t TofBin) const {
+    return Pixel * tofBins() + TofBin;
+  }
+
+  /// \brief staging buffer for the events of a message
+  PackedEvents events() const { return PackedEvents(pixels(), tofBins()); }
+
+  /// \brief count the (pixel index, TOF bin) events, they may repeat
+  void add(const PackedEvents &Events) {
+    std::lock_guard<std::mutex> Lock(mMutex);
+    Events.forEach([this](uint32_t Pixel, uint32_t TofBin) {
+      const size_t Cell = cell(Pixel, TofBin);
+      if (mCounts.add(Cell) == 0) {
+        mOverflow[Cell]++;
+      }
+    });
+  }
+
+  /// \brief summed TOF spectrum of a set of pixels
+  /// \param Pixels Pixel indices (pixel id - 1), out of range ones are ignored
+  std::vector<uint64_t> spectrum(const std::vector<uint32_t> &Pixels) const {
+    const size_t Bins = tofBins();
+
+    // Only the allocated blocks of the pixels are copied while the decode
+    // thread is locked out, they are summed afterwards
+    struct Part {
+      uint32_t Bin;
+      uint32_t Count;
+      std::array<uint16_t, BlockSparseStorage<uint16_t>::BlockCells> Low;
+    };
+    std::vector<Part> Parts;
+    std::vector<std::pair<uint32_t, uint32_t>> Wraps;
+    {
+      std::lock_guard<std::mutex> Lock(mMutex);
+      for (const auto Pixel : Pixels) {
+        if (Pixel >= pixels()) {
+          continue;
+        }
+        const size_t Begin = cell(Pixel, 0);
+        const size_t End = Begin + Bins;
+        mCounts.storage().forEachTile(
+            Begin, End, [&](size_t First, const uint16_t *Low, size_t Cells) {
+              const size_t From = std::max(First, Begin);
+              const size_t To = std::min(First + Cells, End);
+              Part &P = Parts.emplace_back();
+              P.Bin = From - Begin;
+              P.Count = To - From;
+              std::copy(Low + (From - First), Low + (To - First), P.Low.begin());
+              if (mOverflow.empty()) {
+                return;
+              }
+              for (size_t Cell = From; Cell < To; Cell++) {
+                auto Wrap = mOverflow.find(Cell);
+                if (Wrap != mOverflow.end()) {
+                  Wraps.emplace_back(Cell - Begin, Wrap->second);
+                }
+              }
+            });
+      }
+    }
+
+    std::vector<uint64_t> Spectrum(Bins, 0);
+    for (const auto &P : Parts) {
+      for (size_t i = 0; i < P.Count; i++) {
+        Spectrum[P.Bin + i] += P.Low[i];
+      }
+    }
+    for (const auto &[Bin, Count] : Wraps) {
+      Spectrum[Bin] += uint64_t(Count) << 16;
+    }
+    return Spectrum;
+  }
+
+private:
+  mutable std::mutex mMutex;
+
+  /// \brief low 16 bits of the counts
+  Histogram<2, uint16_t, BlockSparseStorage> mCounts;
+
+  /// \brief number of times a cell counter wrapped around
+  std::unordered_map<size_t, uint32_t> mOverflow;
+};
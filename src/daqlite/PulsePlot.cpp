@@ -0,0 +1,130 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file PulsePlot.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include <PulsePlot.h>
+
+#include <AbstractPlot.h>
+#include <types/PlotType.h>
+#include <Configuration.h>
+#include <ESSConsumer.h>
+
+#include <QPlot/qcustomplot/qcustomplot.h>
+#include <QBrush>
+#include <QColor>
+#include <QEvent>
+
+#include <algorithm>
+#include <vector>
+
+using std::vector;
+
+PulsePlot::PulsePlot(Configuration &Config, ESSConsumer &Consumer)
+    : AbstractPlot(PlotType::PULSES, Consumer)
+    , mConfig(Config)
+    , mCursor(Consumer.pulses().subscribe()) {
+  // Register callback functions for events
+  connect(this, &QCustomPlot::mouseMove, this, &PulsePlot::showPointToolTip);
+  setAttribute(Qt::WA_AlwaysShowToolTips);
+
+  setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
+
+  axisRect()->setupFullAxesBox(true);
+
+  yAxis->setRangeReversed(false);
+  yAxis->setSubTicks(true);
+  xAxis->setSubTicks(false);
+
+  mGraph = new QCPGraph(xAxis, yAxis);
+  mGraph->setBrush(QBrush(QColor(0, 0, 255, 20)));
+  mGraph->setLineStyle(QCPGraph::lsStepCenter);
+  mGraph->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssCircle, 3));
+  legend->setVisible(true);
+
+  if (mConfig.mPlot.XAxis.empty()) {
+    xAxis->setLabel("Pulse time (s)");
+  } else {
+    xAxis->setLabel(mConfig.mPlot.XAxis.c_str());
+  }
+  yAxis->setLabel("Events / pulse");
+
+  setCustomParameters();
+}
+
+void PulsePlot::setCustomParameters() {
+  if (mConfig.mPlot.LogScale) {
+    yAxis->setScaleType(QCPAxis::stLogarithmic);
+  } else {
+    yAxis->setScaleType(QCPAxis::stLinear);
+  }
+}
+
+void PulsePlot::updateData() {
+  for (const auto &Pulses : mConsumer.pulses().pull(mCursor)) {
+    for (const auto &Pulse : *Pulses) {
+      mPulses[Pulse.Time] += Pulse.Events;
+    }
+  }
+
+  while (mPulses.size() > MaxPulses) {
+    mPulses.erase(mPulses.begin());
+  }
+}
+
+double PulsePlot::pulseRate() const {
+  if (mPulses.size() < 2) {
+    return 0.0;
+  }
+  double Seconds = (mPulses.rbegin()->first - mPulses.begin()->first) * 1e-9;
+  return (Seconds > 0) ? (mPulses.size() - 1) / Seconds : 0.0;
+}
+
+void PulsePlot::plotDetectorImage(bool) {
+  auto Data = mGraph->data();
+  if (Data->size() != int(mPulses.size())) {
+    Data->set(QVector<QCPGraphData>(mPulses.size()), true);
+  }
+
+  // Times are relative to the most recent pulse
+  const int64_t Last = mPulses.empty() ? 0 : mPulses.rbegin()->first;
+  double MaxEvents = 0;
+  auto Point = Data->begin();
+  for (const auto &[Time, Events] : mPulses) {
+    Point->key = (Time - Last) * 1e-9;
+    Point->value = Events;
+    MaxEvents = std::max(MaxEvents, double(Events));
+    ++Point;
+  }
+
+  mGraph->setName(QString("Events per pulse, %1 Hz").arg(pulseRate(), 0, 'f', 2));
+
+  if (mConfig.mTOF.AutoScaleX and not mPulses.empty()) {
+    xAxis->setRange((mPulses.begin()->first - Last) * 1e-9, 0);
+  }
+  if (mConfig.mTOF.AutoScaleY) {
+    yAxis->setRange(0, MaxEvents * 1.05);
+  }
+  replot();
+}
+
+void PulsePlot::clearDetectorImage() {
+  mPulses.clear();
+  plotDetectorImage(true);
+}
+
+// MouseOver, display pulse time and events in tooltip
+void PulsePlot::showPointToolTip(QMouseEvent *event) {
+  double x = xAxis->pixelToCoord(event->pos().x());
+
+  // Nearest drawn pulse
+  auto Data = mGraph->data();
+  auto Point = Data->findBegin(x, true);
+  if (Point == Data->constEnd()) {
+    setToolTip(QString());
+    return;
+  }
+  setToolTip(QString("Time: %1 s Events: %2").arg(Point->key).arg(Point->value));
+}
@@ -0,0 +1,64 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file PulsePlot.h
+///
+/// \brief Accepted events per neutron pulse over time, and the pulse rate
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <AbstractPlot.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Forward declarations
+class Configuration;
+class ESSConsumer;
+class QCPGraph;
+class QMouseEvent;
+
+class PulsePlot : public AbstractPlot {
+  Q_OBJECT
+public:
+  /// \brief plot needs the configurable plotting options
+  PulsePlot(Configuration &Config, ESSConsumer &Consumer);
+
+  /// \brief adds the pulses since the last update, drawing is left to
+  /// plotDetectorImage()
+  void updateData() override;
+
+  /// \brief update plot based on (possibly dynamic) config settings
+  void setCustomParameters() override;
+
+  ///
+  void clearDetectorImage() override;
+
+public slots:
+  void showPointToolTip(QMouseEvent *event);
+
+private:
+  /// \brief updates the graph
+  void plotDetectorImage(bool Force) override;
+
+  /// \brief pulses per second over the pulses shown
+  double pulseRate() const;
+
+  QCPGraph *mGraph{nullptr};
+
+  /// \brief configuration obtained from main()
+  Configuration &mConfig;
+
+  /// \brief accepted events by pulse time (ns), the most recent pulses only.
+  /// A pulse split over several messages is summed up
+  std::map<int64_t, uint64_t> mPulses;
+
+  /// \brief position in the pulse deltas of the consumer
+  SnapshotBus<std::vector<PulseCount>>::Cursor mCursor;
+
+  /// \brief number of pulses kept
+  static constexpr size_t MaxPulses{1000};
+};
@@ -0,0 +1,76 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file RefreshScheduler.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include <RefreshScheduler.h>
+
+#include <AbstractPlot.h>
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include <algorithm>
+
+void RefreshScheduler::addPlot(AbstractPlot *Plot, double RateHz) {
+  if (RateHz <= 0.0) {
+    RateHz = defaultRate(Plot->getPlotType());
+  }
+
+  auto Item = std::make_unique<Entry>();
+  Item->Plot = Plot;
+  Item->Timer = new QTimer(this);
+  Item->Period = std::chrono::nanoseconds(int64_t(1e9 / RateHz));
+  Item->Timer->setInterval(
+      std::max(1, int(Item->Period.count() / 1000000)));
+
+  Entry *Ptr = Item.get();
+  connect(Item->Timer, &QTimer::timeout, this, [this, Ptr]() { refresh(*Ptr); });
+  mEntries.push_back(std::move(Item));
+}
+
+void RefreshScheduler::start() {
+  for (auto &Item : mEntries) {
+    Item->Timer->start();
+  }
+}
+
+double RefreshScheduler::defaultRate(PlotType Type) {
+  switch (Type) {
+  case PlotType::TOF:
+  case PlotType::HISTOGRAM:
+  case PlotType::PULSES:
+    return 5.0;
+
+  default:
+    return 1.0;
+  }
+}
+
+bool RefreshScheduler::isShown(const AbstractPlot *Plot) {
+  return Plot->isVisible() and not Plot->window()->isMinimized();
+}
+
+void RefreshScheduler::refresh(Entry &Item) {
+  // Always pull the data, also for hidden plots, so that nothing is lost when
+  // the window is shown again
+  Item.Plot->updateData();
+
+  if (not isShown(Item.Plot)) {
+    return;
+  }
+
+  // Frame dropping: a render that took longer than the refresh period used
+  // the budget of the following frames as well
+  if (Item.DropFrames > 0) {
+    Item.DropFrames--;
+    return;
+  }
+
+  QElapsedTimer Timer;
+  Timer.start();
+  Item.Plot->plotDetectorImage(false);
+  Item.DropFrames = Timer.nsecsElapsed() / Item.Period.count();
+}
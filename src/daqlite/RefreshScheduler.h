@@ -0,0 +1,65 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file RefreshScheduler.h
+///
+/// \brief Per plot refresh timing for daqlite
+///
+/// Every plot gets its own refresh timer, so that for example TOF plots can be
+/// redrawn at 5 Hz while large 2D maps are redrawn once per second. The
+/// timers run in the Qt main thread and are independent of message arrival
+/// in the worker thread.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <types/PlotType.h>
+
+#include <QObject>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Forward declarations
+class AbstractPlot;
+class QTimer;
+
+class RefreshScheduler : public QObject {
+  Q_OBJECT
+
+public:
+  RefreshScheduler(QObject *parent = nullptr) : QObject(parent) {}
+
+  /// \brief register a plot to be refreshed periodically
+  /// \param Plot    The plot to refresh
+  /// \param RateHz  Refresh rate, if not positive the plot type default is
+  ///                used
+  void addPlot(AbstractPlot *Plot, double RateHz);
+
+  /// \brief start refreshing all registered plots
+  void start();
+
+  /// \brief default refresh rate for a plot type
+  static double defaultRate(PlotType Type);
+
+private:
+  struct Entry {
+    AbstractPlot *Plot;
+    QTimer *Timer;
+    std::chrono::nanoseconds Period;
+
+    /// \brief Number of upcoming frames to skip after a slow render
+    int64_t DropFrames{0};
+  };
+
+  /// \brief pull new data into the plot and redraw it if it is visible and
+  /// within its render budget
+  void refresh(Entry &Item);
+
+  /// \brief true if the plot is actually shown on screen
+  static bool isShown(const AbstractPlot *Plot);
+
+  std::vector<std::unique_ptr<Entry>> mEntries;
+};
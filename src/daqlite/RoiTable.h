@@ -0,0 +1,104 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file RoiTable.h
+///
+/// \brief Pixel to region of interest lookup table
+///
+/// Regions of interest (ROIs) are polygons in (x, y) pixel coordinates and
+/// cover all z. The table holds one bit mask per pixel with bit i set if the
+/// pixel center is inside ROI i, so the decode loop finds all ROIs of an
+/// event with a single lookup, however many ROIs are defined.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+class RoiTable {
+public:
+  using Mask = uint64_t;
+
+  /// \brief Maximum number of ROIs, one bit each
+  static constexpr size_t MaxRois{64};
+
+  struct Roi {
+    std::string Name;
+    std::vector<std::pair<double, double>> Polygon; ///< (x, y) vertices
+  };
+
+  /// \brief rectangle with corners (X0, Y0) and (X1, Y1), edges included
+  static Roi rectangle(const std::string &Name, double X0, double Y0,
+                       double X1, double Y1) {
+    // pixel centers are at integer coordinates
+    double Left = std::min(X0, X1) - 0.5;
+    double Right = std::max(X0, X1) + 0.5;
+    double Bottom = std::min(Y0, Y1) - 0.5;
+    double Top = std::max(Y0, Y1) + 0.5;
+    return {Name, {{Left, Bottom}, {Right, Bottom}, {Right, Top}, {Left, Top}}};
+  }
+
+  RoiTable() = default;
+
+  /// \brief compile the masks for a XDim x YDim x ZDim geometry
+  /// \param Rois  ROIs beyond MaxRois are ignored
+  RoiTable(int XDim, int YDim, int ZDim, std::vector<Roi> Rois)
+      : mRois(std::move(Rois)) {
+    if (mRois.size() > MaxRois) {
+      mRois.resize(MaxRois);
+    }
+
+    // Pixel ids start from 1, x fastest then y then z
+    const size_t Plane = size_t(XDim) * YDim;
+    mMasks.assign(Plane * ZDim + 1, 0);
+
+    std::vector<Mask> PlaneMasks(Plane, 0);
+    for (size_t r = 0; r < mRois.size(); r++) {
+      for (int y = 0; y < YDim; y++) {
+        for (int x = 0; x < XDim; x++) {
+          if (inside(mRois[r].Polygon, x, y)) {
+            PlaneMasks[size_t(y) * XDim + x] |= Mask(1) << r;
+          }
+        }
+      }
+    }
+
+    for (int z = 0; z < ZDim; z++) {
+      std::copy(PlaneMasks.begin(), PlaneMasks.end(),
+                mMasks.begin() + 1 + z * Plane);
+    }
+  }
+
+  /// \brief ROIs of a pixel id (without offset), 0 if out of range
+  Mask mask(uint32_t PixelId) const {
+    return PixelId < mMasks.size() ? mMasks[PixelId] : 0;
+  }
+
+  const std::vector<Roi> &rois() const { return mRois; }
+  size_t size() const { return mRois.size(); }
+  bool empty() const { return mRois.empty(); }
+
+private:
+  /// \brief even-odd rule point in polygon test
+  static bool inside(const std::vector<std::pair<double, double>> &Polygon,
+                     double X, double Y) {
+    bool Inside = false;
+    for (size_t i = 0, j = Polygon.size() - 1; i < Polygon.size(); j = i++) {
+      auto [Xi, Yi] = Polygon[i];
+      auto [Xj, Yj] = Polygon[j];
+      if (((Yi > Y) != (Yj > Y)) and
+          (X < (Xj - Xi) * (Y - Yi) / (Yj - Yi) + Xi)) {
+        Inside = not Inside;
+      }
+    }
+    return Inside;
+  }
+
+  std::vector<Roi> mRois;
+  std::vector<Mask> mMasks;
+};
@@ -0,0 +1,135 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file RollingWindow.h
+///
+/// \brief Rolling time window for live histograms
+///
+/// The counts added to a histogram are also recorded in a ring of time
+/// slices (e.g. 1 s each). When a slice drops out of the window its counts
+/// are subtracted from the histogram again, so the histogram is the running
+/// sum of the last Slices slices instead of being zeroed on a timer.
+///
+/// Slices are block sparse: only the 64 cell blocks that received counts
+/// during a slice are allocated, so memory follows the number of active
+/// cells. A slice of a busy detector can still hold all cells, so the
+/// slices are made longer (and fewer) if their dense counters would take
+/// more than MaxBytes together. Expired slices are handed back a block of
+/// contiguous counters at a time.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <HistogramStorage.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+template <typename Counter = uint32_t> class RollingWindow {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// \brief memory ceiling of the counters of all slices
+  static constexpr size_t MaxBytes{size_t(256) << 20};
+
+  /// \brief set up (or disable) the window, dropping all recorded counts
+  /// \param Cells          Number of histogram cells
+  /// \param WindowSeconds  Window length, rounded up to whole slices. The
+  ///                       window is disabled for values <= 0
+  /// \param SliceSeconds   Time resolution of the window, coarser if the
+  ///                       slices would exceed MaxBytes
+  void setup(size_t Cells, double WindowSeconds, double SliceSeconds) {
+    mSlices.clear();
+    if (WindowSeconds <= 0 or SliceSeconds <= 0) {
+      return;
+    }
+
+    size_t Slices = std::max(1.0, std::ceil(WindowSeconds / SliceSeconds));
+    const size_t SliceBytes = std::max<size_t>(Cells, 1) * sizeof(Counter);
+    const size_t MaxSlices = std::max<size_t>(1, MaxBytes / SliceBytes);
+    if (Slices > MaxSlices) {
+      Slices = MaxSlices;
+      SliceSeconds = WindowSeconds / Slices;
+      fmt::print("Rolling window of {} cells uses {} slices of {} s\n", Cells,
+                 Slices, SliceSeconds);
+    }
+    mSlices.resize(Slices);
+    for (auto &Slice : mSlices) {
+      Slice.resize(Cells);
+    }
+    mSliceLength = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(SliceSeconds));
+    mCurrent = 0;
+    mSliceStart = Clock::time_point();
+  }
+
+  bool enabled() const { return not mSlices.empty(); }
+
+  /// \brief record counts added to the histogram in the current slice
+  void add(size_t Index, Counter Count) {
+    mSlices[mCurrent].add(Index, Count);
+  }
+
+  /// \brief record a histogram of added counts, e.g. a HistogramDelta
+  /// \param Offset  Cell index of the first count
+  /// \param First   Index in Counts of the first count, to add a slice
+  /// \param Cells   Number of counts of the slice, at most up to the end of
+  ///                the window cells
+  template <typename Deltas>
+  void add(const Deltas &Counts, size_t Offset = 0, size_t First = 0,
+           size_t Cells = SIZE_MAX) {
+    auto &Slice = mSlices[mCurrent];
+    if (Offset >= Slice.size()) {
+      return;
+    }
+    Cells = std::min(Cells, Slice.size() - Offset);
+    Counts.forEach(First, Cells, [&](size_t i, auto Count) {
+      Slice.add(Offset + i, Counter(Count));
+    });
+  }
+
+  /// \brief start new slices as time passes
+  /// \param Expire  called as Expire(First, Counts, Cells) for the blocks of
+  ///                the slices dropping out of the window, to subtract the
+  ///                Cells counts (some zero) of the cells from First on
+  template <typename Fn> void advance(Clock::time_point Now, Fn &&Expire) {
+    if (mSliceStart == Clock::time_point()) {
+      mSliceStart = Now;
+      return;
+    }
+
+    // After a long pause all slices have expired
+    size_t Steps = 0;
+    while (Now - mSliceStart >= mSliceLength and Steps < mSlices.size()) {
+      mCurrent = (mCurrent + 1) % mSlices.size();
+      mSlices[mCurrent].forEachTile(Expire);
+      mSlices[mCurrent].clear();
+      mSliceStart += mSliceLength;
+      Steps++;
+    }
+    if (Now - mSliceStart >= mSliceLength) {
+      mSliceStart = Now;
+    }
+  }
+
+  /// \brief forget all recorded counts, when the histogram is cleared
+  void clear() {
+    for (auto &Slice : mSlices) {
+      Slice.clear();
+    }
+  }
+
+private:
+  std::vector<BlockSparseStorage<Counter>> mSlices;
+
+  /// \brief slice receiving counts, and when it started
+  size_t mCurrent{0};
+  Clock::time_point mSliceStart;
+  Clock::duration mSliceLength{};
+};
@@ -0,0 +1,362 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file SnapshotBus.h
+///
+/// \brief Versioned publication of immutable data from the worker (single
+/// writer) to any number of plots
+///
+/// The writer publishes epochs: immutable, reference counted data with a
+/// version number, appended to a singly linked list. Each reader holds a
+/// cursor on the last epoch it has seen and pulls the epochs after it. No
+/// data is copied, readers share the epochs, and how many readers there are
+/// or how often they read does not matter: each reader sees every epoch
+/// published after it subscribed exactly once.
+///
+/// An epoch is freed when all cursors have moved past it. The backlog is
+/// capped: once an epoch is MaxBacklog versions old, the writer unlinks it
+/// from its successor. A reader that stopped pulling then keeps at most the
+/// epoch at its cursor alive, and is resynchronized to the latest epoch on
+/// its next pull, skipping the epochs it missed.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+template <typename T> class SnapshotBus {
+  struct Epoch {
+    uint64_t Version{0};
+    T Data{};
+
+    /// \brief set once by the writer, when the next epoch is published
+    std::shared_ptr<Epoch> Next;
+
+    /// \brief set by the writer when Next was unlinked, the epochs after
+    /// this one are lost to readers still here
+    std::atomic<bool> Expired{false};
+
+    /// \brief free the following epochs that only this one holds in a loop
+    /// rather than by recursion, which could overflow the stack
+    ~Epoch() {
+      std::shared_ptr<Epoch> Following = std::move(Next);
+      while (Following and Following.use_count() == 1) {
+        std::shared_ptr<Epoch> After = std::move(Following->Next);
+        Following = std::move(After);
+      }
+    }
+  };
+
+public:
+  using Snapshot = std::shared_ptr<const T>;
+
+  /// \brief Epochs a reader may lag behind before it is resynchronized,
+  /// 50 s of the 50 ms publish period of the consumer
+  static constexpr size_t DefaultMaxBacklog{1000};
+
+  /// \brief Position of a reader, obtained from subscribe()
+  class Cursor {
+  public:
+    /// \brief version of the last epoch seen
+    uint64_t version() const { return mLast ? mLast->Version : 0; }
+
+    /// \brief number of epochs skipped because the reader lagged behind
+    uint64_t skipped() const { return mSkipped; }
+
+  private:
+    friend class SnapshotBus;
+    std::shared_ptr<const Epoch> mLast;
+    uint64_t mSkipped{0};
+  };
+
+  explicit SnapshotBus(size_t MaxBacklog = DefaultMaxBacklog)
+      : mTail(std::make_shared<Epoch>()), mMaxBacklog(MaxBacklog) {
+    assert(mMaxBacklog > 0);
+    mAging.push_back(mTail);
+  }
+
+  // ----------------------------------------------------------------- writer
+
+  /// \brief Publish data as the next epoch
+  void publish(T Data) {
+    auto Next = std::make_shared<Epoch>();
+    Next->Version = mTail->Version + 1;
+    Next->Data = std::move(Data);
+
+    // Readers following the list see the epoch once it is linked
+    std::atomic_store(&mTail->Next, Next);
+    std::atomic_store(&mTail, Next);
+
+    // Unlink the epoch that is now too old, if a reader still holds it
+    mAging.push_back(Next);
+    if (mAging.size() > mMaxBacklog) {
+      if (auto Old = mAging.front().lock()) {
+        Old->Expired.store(true);
+        std::atomic_store(&Old->Next, std::shared_ptr<Epoch>());
+      }
+      mAging.pop_front();
+    }
+  }
+
+  // ----------------------------------------------------------------- reader
+
+  /// \brief A cursor receiving the epochs published from now on
+  Cursor subscribe() const {
+    Cursor Reader;
+    Reader.mLast = std::atomic_load(&mTail);
+    return Reader;
+  }
+
+  /// \brief The epochs published since the last pull() with this cursor,
+  /// oldest first
+  std::vector<Snapshot> pull(Cursor &Reader) const {
+    std::vector<Snapshot> Epochs;
+    if (not Reader.mLast) {
+      Reader.mLast = std::atomic_load(&mTail);
+      return Epochs;
+    }
+
+    // The reader lagged behind and lost its successors, start over from the
+    // latest epoch
+    if (Reader.mLast->Expired.load() and
+        not std::atomic_load(&Reader.mLast->Next)) {
+      auto Latest = std::atomic_load(&mTail);
+      Reader.mSkipped += Latest->Version - Reader.mLast->Version;
+      Reader.mLast = std::move(Latest);
+      return Epochs;
+    }
+
+    for (auto Next = std::atomic_load(&Reader.mLast->Next); Next;
+         Next = std::atomic_load(&Next->Next)) {
+      // Shares ownership of the epoch, points to its data
+      Epochs.emplace_back(Next, &Next->Data);
+      Reader.mLast = Next;
+    }
+    return Epochs;
+  }
+
+private:
+  /// \brief the latest epoch, only replaced by the writer
+  std::shared_ptr<Epoch> mTail;
+
+  /// \brief the last MaxBacklog epochs, oldest first, writer only
+  std::deque<std::weak_ptr<Epoch>> mAging;
+  size_t mMaxBacklog;
+};
+
+/// \brief Counts added to a histogram, stored dense or as sparse
+/// (index, count) pairs, whichever is smaller
+///
+/// \tparam Counter The type of the counters.
+template <typename Counter> class HistogramDelta {
+public:
+  HistogramDelta() = default;
+
+  /// \brief dense counts, one per cell
+  explicit HistogramDelta(std::vector<Counter> Counts)
+      : mSize(Counts.size()), mValues(std::move(Counts)), mDense(true) {}
+
+  /// \brief sparse counts of the cells at the indices, for a histogram of
+  /// Size cells
+  HistogramDelta(size_t Size, std::vector<uint32_t> Indices,
+                 std::vector<Counter> Counts)
+      : mSize(Size), mIndices(std::move(Indices)), mValues(std::move(Counts)) {}
+
+  /// \brief number of cells of the histogram
+  size_t size() const { return mSize; }
+
+  bool dense() const { return mDense; }
+
+  /// \brief calls Func(Index, Count) for the cells with counts
+  template <typename Fn> void forEach(Fn &&Func) const {
+    forEach(0, mSize, Func);
+  }
+
+  /// \brief calls Func(Index - First, Count) for the cells with counts
+  /// among the cells First to First + Cells - 1, e.g. of one view
+  template <typename Fn>
+  void forEach(size_t First, size_t Cells, Fn &&Func) const {
+    if (mDense) {
+      const size_t Last = std::min(mSize, First + Cells);
+      for (size_t i = First; i < Last; i++) {
+        if (mValues[i] != 0) {
+          Func(i - First, mValues[i]);
+        }
+      }
+      return;
+    }
+    for (size_t k = 0; k < mIndices.size(); k++) {
+      const size_t Index = mIndices[k];
+      if (Index >= First and Index - First < Cells) {
+        Func(Index - First, mValues[k]);
+      }
+    }
+  }
+
+private:
+  size_t mSize{0};
+  std::vector<uint32_t> mIndices; ///< Sparse only, in no particular order
+  std::vector<Counter> mValues;
+  bool mDense{false};
+};
+
+/// \brief Histogram deltas accumulated by the writer and published on a
+/// SnapshotBus, one epoch per publish() with counts added since the last one
+///
+/// The writer remembers the cells it increments, and the blocks of 64 cells
+/// that whole vectors of counts were added to, so a sparse epoch is built
+/// and the pending counts are reset in time proportional to the touched
+/// cells rather than to the histogram size. Vectors are added a block at a
+/// time without a branch per cell. Readers iterate the epochs with
+/// HistogramDelta::forEach() in time proportional to the new counts.
+///
+/// \tparam Counter The type of the counters.
+template <typename Counter>
+class DeltaBus : public SnapshotBus<HistogramDelta<Counter>> {
+public:
+  static constexpr size_t BlockCells{64};
+
+  /// \brief Adds values of a vector of any numeric type to the counters
+  template <typename Value> void add_values(const std::vector<Value> &Values) {
+    pending(Values.size());
+    Counter *Pending = mPending.data();
+    for (size_t First = 0; First < Values.size(); First += BlockCells) {
+      const size_t Last = std::min(Values.size(), First + BlockCells);
+      Counter Any{0};
+      for (size_t i = First; i < Last; i++) {
+        const Counter Count = static_cast<Counter>(Values[i]);
+        Pending[i] += Count;
+        Any |= Count;
+      }
+      if (Any != 0) {
+        const size_t Block = First / BlockCells;
+        mBlocks[Block / 64] |= uint64_t(1) << (Block % 64);
+      }
+    }
+  }
+
+  /// \brief Increments the counters at the given indices by one
+  /// \param Indices Indices of the counters to increment, may repeat.
+  /// \param MinSize The histogram has at least this size.
+  void increment(const std::vector<uint32_t> &Indices, size_t MinSize) {
+    pending(MinSize);
+    for (const auto Index : Indices) {
+      assert(Index < mPending.size());
+      add(Index, Counter(1));
+    }
+  }
+
+  /// \brief Publish the counts added since the last publish(), if any
+  void publish() {
+    if (not mDirty) {
+      return;
+    }
+
+    // Sparse while the pairs take less memory than the dense counts. The
+    // taken counters are reset, so cells both listed and in a marked block
+    // (or listed twice after wrapping to zero) are only taken once
+    std::vector<uint32_t> Indices;
+    std::vector<Counter> Counts;
+    const size_t MaxPairs = mSize * sizeof(Counter) / PairBytes;
+    auto Take = [&](size_t Index) {
+      if (mPending[Index] != 0) {
+        Indices.push_back(Index);
+        Counts.push_back(mPending[Index]);
+        mPending[Index] = 0;
+      }
+    };
+
+    bool Sparse = mTracking;
+    if (Sparse) {
+      Indices.reserve(mTouched.size());
+      Counts.reserve(mTouched.size());
+      for (const auto Index : mTouched) {
+        Take(Index);
+      }
+      for (size_t w = 0; w < mBlocks.size() and Sparse; w++) {
+        for (uint64_t Word = mBlocks[w]; Word != 0; Word &= Word - 1) {
+          const size_t First = (w * 64 + __builtin_ctzll(Word)) * BlockCells;
+          const size_t Last = std::min(mSize, First + BlockCells);
+          for (size_t i = First; i < Last; i++) {
+            Take(i);
+          }
+          if (Indices.size() >= MaxPairs) {
+            Sparse = false;
+            break;
+          }
+        }
+      }
+    }
+
+    if (Sparse) {
+      SnapshotBus<HistogramDelta<Counter>>::publish(
+          HistogramDelta<Counter>(mSize, std::move(Indices), std::move(Counts)));
+    } else {
+      // Put back what was taken, the pending counters then become the
+      // epoch instead of being copied
+      for (size_t k = 0; k < Indices.size(); k++) {
+        mPending[Indices[k]] = Counts[k];
+      }
+      const size_t Capacity = mPending.size();
+      mPending.resize(mSize);
+      SnapshotBus<HistogramDelta<Counter>>::publish(
+          HistogramDelta<Counter>(std::move(mPending)));
+      mPending.assign(Capacity, Counter(0));
+    }
+
+    mTouched.clear();
+    std::fill(mBlocks.begin(), mBlocks.end(), 0);
+    mTracking = true;
+    mSize = 0;
+    mDirty = false;
+  }
+
+private:
+  static constexpr size_t PairBytes{sizeof(uint32_t) + sizeof(Counter)};
+
+  /// \brief Pending counts for a histogram of at least MinSize cells
+  void pending(size_t MinSize) {
+    if (mPending.size() < MinSize) {
+      mPending.resize(MinSize, Counter(0));
+      mBlocks.resize((MinSize + 64 * BlockCells - 1) / (64 * BlockCells), 0);
+    }
+    mSize = std::max(mSize, MinSize);
+    mDirty = true;
+  }
+
+  void add(size_t Index, Counter Count) {
+    if (mPending[Index] == 0 and mTracking) {
+      mTouched.push_back(Index);
+
+      // Too many cells for a sparse epoch, stop listing them
+      if (mTouched.size() * PairBytes >= mPending.size() * sizeof(Counter)) {
+        mTracking = false;
+      }
+    }
+    mPending[Index] += Count;
+  }
+
+  /// \brief zero outside of the touched cells and blocks, and kept between
+  /// epochs
+  std::vector<Counter> mPending;
+
+  /// \brief cells incremented since the last epoch
+  std::vector<uint32_t> mTouched;
+  bool mTracking{true}; ///< false if the epoch will be dense
+
+  /// \brief one bit per block of BlockCells counters that vectors of counts
+  /// were added to since the last epoch
+  std::vector<uint64_t> mBlocks;
+
+  /// \brief histogram size of the next epoch
+  size_t mSize{0};
+  bool mDirty{false};
+};
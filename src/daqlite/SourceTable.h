@@ -0,0 +1,64 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file SourceTable.h
+///
+/// \brief Interned source (or topic) names of the messages
+///
+/// The configured names are interned once to small ids. Messages are matched
+/// by comparing their name in place, without copying it, so filtering costs
+/// no allocation per message. Messages mostly arrive in runs from the same
+/// source, so the last match is tried first.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class SourceTable {
+public:
+  using Id = uint32_t;
+
+  /// \brief returned by find() for names that have not been interned
+  static constexpr Id Unknown{UINT32_MAX};
+
+  /// \brief id of a source name, which is added if new
+  Id intern(const std::string &Name) {
+    for (Id i = 0; i < mNames.size(); i++) {
+      if (mNames[i] == Name) {
+        return i;
+      }
+    }
+    mNames.push_back(Name);
+    return mNames.size() - 1;
+  }
+
+  /// \brief id of a source name, or Unknown
+  /// \param Name  e.g. the source_name() of a message, not copied
+  Id find(std::string_view Name) {
+    if (mLast < mNames.size() and mNames[mLast] == Name) {
+      return mLast;
+    }
+    for (Id i = 0; i < mNames.size(); i++) {
+      if (mNames[i] == Name) {
+        mLast = i;
+        return i;
+      }
+    }
+    return Unknown;
+  }
+
+  const std::string &name(Id Source) const { return mNames[Source]; }
+  size_t size() const { return mNames.size(); }
+  bool empty() const { return mNames.empty(); }
+
+private:
+  std::vector<std::string> mNames;
+
+  /// \brief id of the last match
+  Id mLast{0};
+};
@@ -99,6 +99,19 @@ public:
     }
   }
 
+  /// \brief Increments the elements at the given indices by one.
+  /// \param indices Indices of the elements to increment, may repeat.
+  /// \param minSize The vector is grown to at least this size first.
+  void increment(const std::vector<uint32_t> &indices, const size_t minSize) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mVector.size() < minSize) {
+      mVector.resize(minSize);
+    }
+    for (const auto index : indices) {
+      mVector[index] += 1;
+    }
+  }
+
   /// \brief Assigns values from another vector to this vector.
   /// \param other The vector containing values to be assigned.
   /// \return A reference to this vector.
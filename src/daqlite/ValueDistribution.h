@@ -0,0 +1,143 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file ValueDistribution.h
+///
+/// \brief Running min/max and quantiles of histogram cell values
+///
+/// The distribution of the non-zero cell values is kept in log-linear buckets
+/// (16 buckets per power of two, i.e. ~6% relative resolution) and is updated
+/// every time a cell changes. Color and axis ranges can then be found in
+/// constant time per frame, independent of the number of cells, and a 1st -
+/// 99th percentile range keeps a few hot pixels from washing out the display.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+class ValueDistribution {
+public:
+  /// \brief register that a cell changed its value
+  /// \param Old  Value before the update
+  /// \param New  Value after the update
+  void update(double Old, double New) {
+    if (Old > 0) {
+      mBuckets[bucket(Old)]--;
+      mNonZero--;
+    }
+    if (New > 0) {
+      mBuckets[bucket(New)]++;
+      mNonZero++;
+    }
+
+    if (New >= mMax) {
+      mMax = New;
+    } else if (Old >= mMax) {
+      // The maximum decreased, fall back to the buckets until it grows again
+      mMax = (mNonZero == 0) ? 0 : upperEdge(topBucket());
+    }
+  }
+
+  /// \brief forget all values (all cells are zero)
+  void clear() {
+    mBuckets.fill(0);
+    mNonZero = 0;
+    mMax = 0;
+  }
+
+  /// \brief number of non-zero cells
+  size_t nonZero() const { return mNonZero; }
+
+  /// \brief largest cell value, exact as long as values only grow
+  double max() const { return mMax; }
+
+  /// \brief (approximate) smallest non-zero cell value
+  double minNonZero() const {
+    for (size_t i = 0; i < Buckets; i++) {
+      if (mBuckets[i] != 0) {
+        return lowerEdge(i);
+      }
+    }
+    return 0;
+  }
+
+  /// \brief (approximate) value below which a fraction Q of the non-zero
+  /// cells lie
+  double quantile(double Q) const {
+    if (mNonZero == 0) {
+      return 0;
+    }
+    uint64_t Rank = uint64_t(std::clamp(Q, 0.0, 1.0) * (mNonZero - 1));
+    uint64_t Seen = 0;
+    for (size_t i = 0; i < Buckets; i++) {
+      Seen += mBuckets[i];
+      if (Seen > Rank) {
+        return std::min(upperEdge(i), mMax);
+      }
+    }
+    return mMax;
+  }
+
+  /// \brief data range for color or axis scaling
+  /// \param Cells   Total number of cells, including zeros
+  /// \param Robust  Use the given percentiles of the non-zero cells instead
+  ///                of the full range
+  /// \param LowPercentile  Lower percentile for the robust range
+  /// \param HighPercentile Upper percentile for the robust range
+  std::pair<double, double> range(size_t Cells, bool Robust,
+                                  double LowPercentile,
+                                  double HighPercentile) const {
+    if (Robust) {
+      return {quantile(LowPercentile / 100.0), quantile(HighPercentile / 100.0)};
+    }
+    double Min = (mNonZero < Cells) ? 0.0 : minNonZero();
+    return {Min, mMax};
+  }
+
+private:
+  static constexpr int SubBuckets{16};
+  static constexpr int MinExponent{-32};
+  static constexpr int MaxExponent{64};
+  static constexpr size_t Buckets{(MaxExponent - MinExponent + 1) * SubBuckets};
+
+  /// \brief bucket index for a positive value
+  static size_t bucket(double Value) {
+    int Exponent;
+    double Mantissa = std::frexp(Value, &Exponent); // [0.5, 1)
+    if (Exponent < MinExponent) {
+      return 0;
+    }
+    if (Exponent > MaxExponent) {
+      return Buckets - 1;
+    }
+    int Sub = int((Mantissa - 0.5) * 2 * SubBuckets);
+    return (Exponent - MinExponent) * SubBuckets + Sub;
+  }
+
+  static double lowerEdge(size_t Bucket) {
+    int Exponent = int(Bucket / SubBuckets) + MinExponent;
+    int Sub = Bucket % SubBuckets;
+    return std::ldexp(0.5 + Sub / (2.0 * SubBuckets), Exponent);
+  }
+
+  static double upperEdge(size_t Bucket) { return lowerEdge(Bucket + 1); }
+
+  size_t topBucket() const {
+    for (size_t i = Buckets; i > 0; i--) {
+      if (mBuckets[i - 1] != 0) {
+        return i - 1;
+      }
+    }
+    return 0;
+  }
+
+  std::array<uint64_t, Buckets> mBuckets{};
+  uint64_t mNonZero{0};
+  double mMax{0};
+};
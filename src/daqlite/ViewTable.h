@@ -0,0 +1,183 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file ViewTable.h
+///
+/// \brief Pixel to view lookup table, for demultiplexing several detector
+/// views (e.g. banks) from one decode pass
+///
+/// A view is a pixel id range with its own geometry: pixel ids Offset + 1 to
+/// Offset + XDim * YDim * ZDim, and local pixel ids 1 to XDim * YDim * ZDim.
+/// The table holds one bit mask per pixel id with bit v set if the pixel is
+/// in view v, so the decode loop finds the views of an event with a single
+/// lookup. Views may overlap, e.g. a full instrument view and bank views.
+///
+/// A view can be restricted to the messages of one source, e.g. monitors
+/// sending the same pixel ids on one topic, and to one topic of the broker.
+/// The views accepting a message are found once per message from its
+/// interned topic and source names.
+///
+/// The consumer histograms of all views are concatenated, each view has a
+/// block of pixel cells starting at PixelBase, indexed by local pixel id,
+/// and a block of (Y, TOF) rows starting at RowBase.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <SourceTable.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class ViewTable {
+public:
+  using Mask = uint32_t;
+
+  /// \brief Maximum number of views, one bit each
+  static constexpr size_t MaxViews{32};
+
+  struct View {
+    int XDim{1};
+    int YDim{1};
+    int ZDim{1};
+    int Offset{0};
+    std::string Source{""}; ///< Only messages of this source, if not empty
+    std::string Topic{""};  ///< Only messages of this topic, if not empty
+
+    size_t PixelBase{0}; ///< First pixel cell, for local pixel id 0 (unused)
+    size_t RowBase{0};   ///< First (Y, TOF) row
+
+    size_t pixels() const { return size_t(XDim) * YDim * ZDim; }
+
+    bool sameGeometry(int X, int Y, int Z, int Off) const {
+      return XDim == X and YDim == Y and ZDim == Z and Offset == Off;
+    }
+  };
+
+  ViewTable() = default;
+
+  /// \brief compile the masks and the histogram layout of the views
+  /// \param Views  Geometries of the views, the first is the primary view
+  explicit ViewTable(std::vector<View> Views) : mViews(std::move(Views)) {
+    if (mViews.empty() or mViews.size() > MaxViews) {
+      throw std::runtime_error("Between 1 and 32 geometry views are supported");
+    }
+
+    size_t PixelBase{0};
+    size_t RowBase{0};
+    mMinPixel = UINT32_MAX;
+    mMaxPixel = 0;
+    for (auto &V : mViews) {
+      V.PixelBase = PixelBase;
+      V.RowBase = RowBase;
+      PixelBase += V.pixels() + 1;
+      RowBase += V.YDim;
+      mMinPixel = std::min<uint32_t>(mMinPixel, V.Offset + 1);
+      mMaxPixel = std::max<uint32_t>(mMaxPixel, V.Offset + V.pixels());
+    }
+
+    for (size_t v = 0; v < mViews.size(); v++) {
+      mAllViews |= Mask(1) << v;
+      if (not mViews[v].Topic.empty()) {
+        const SourceTable::Id Id = mTopics.intern(mViews[v].Topic);
+        mTopicMasks.resize(mTopics.size(), 0);
+        mTopicMasks[Id] |= Mask(1) << v;
+      } else {
+        mAnyTopic |= Mask(1) << v;
+      }
+
+      if (mViews[v].Source.empty()) {
+        mAnySource |= Mask(1) << v;
+        continue;
+      }
+      const SourceTable::Id Id = mSources.intern(mViews[v].Source);
+      mSourceMasks.resize(mSources.size(), 0);
+      mSourceMasks[Id] |= Mask(1) << v;
+    }
+    mPixelCells = PixelBase;
+    mRows = RowBase;
+
+    // A single view needs no table, all pixels in range belong to it
+    if (mViews.size() == 1) {
+      return;
+    }
+
+    mMasks.assign(mMaxPixel - mMinPixel + 1, 0);
+    for (size_t v = 0; v < mViews.size(); v++) {
+      const size_t First = mViews[v].Offset + 1 - mMinPixel;
+      for (size_t i = 0; i < mViews[v].pixels(); i++) {
+        mMasks[First + i] |= Mask(1) << v;
+      }
+    }
+  }
+
+  /// \brief views of a pixel id (with offset), the range must be checked
+  /// against minPixel() and maxPixel() first
+  Mask mask(uint32_t PixelId) const {
+    return mMasks.empty() ? 1 : mMasks[PixelId - mMinPixel];
+  }
+
+  /// \brief views accepting the messages of a source, 0 if none
+  /// \param Source  source name of the message, compared in place
+  Mask sourceMask(std::string_view Source) {
+    if (mSources.empty()) {
+      return mAnySource;
+    }
+    const SourceTable::Id Id = mSources.find(Source);
+    return (Id == SourceTable::Unknown) ? mAnySource
+                                        : (mAnySource | mSourceMasks[Id]);
+  }
+
+  /// \brief views accepting the messages of a topic, 0 if none
+  /// \param Topic  topic name of the message, compared in place
+  Mask topicMask(std::string_view Topic) {
+    // With a single topic all messages are of that topic
+    if (mTopics.size() <= 1) {
+      return mAllViews;
+    }
+    const SourceTable::Id Id = mTopics.find(Topic);
+    return (Id == SourceTable::Unknown) ? mAnyTopic
+                                        : (mAnyTopic | mTopicMasks[Id]);
+  }
+
+  /// \brief the distinct topics of the views
+  const SourceTable &topics() const { return mTopics; }
+
+  const View &operator[](size_t Index) const { return mViews[Index]; }
+  size_t size() const { return mViews.size(); }
+
+  /// \brief lowest and highest pixel id of all views
+  uint32_t minPixel() const { return mMinPixel; }
+  uint32_t maxPixel() const { return mMaxPixel; }
+
+  /// \brief size of the concatenated pixel histograms
+  size_t pixelCells() const { return mPixelCells; }
+
+  /// \brief number of (Y, TOF) rows of all views
+  size_t rows() const { return mRows; }
+
+private:
+  std::vector<View> mViews;
+  std::vector<Mask> mMasks;
+
+  /// \brief views of each interned source, and views of any source
+  SourceTable mSources;
+  std::vector<Mask> mSourceMasks;
+  Mask mAnySource{0};
+
+  /// \brief views of each interned topic, and views of any topic
+  SourceTable mTopics;
+  std::vector<Mask> mTopicMasks;
+  Mask mAnyTopic{0};
+  Mask mAllViews{0};
+  uint32_t mMinPixel{0};
+  uint32_t mMaxPixel{0};
+  size_t mPixelCells{0};
+  size_t mRows{0};
+};
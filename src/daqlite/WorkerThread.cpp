@@ -17,15 +17,17 @@ void WorkerThread::run() {
   auto t1 = std::chrono::high_resolution_clock::now();
 
   while (true) {
-    auto Msg = Consumer->consume();
+    // Short timeout so statistics are published on time also when no
+    // messages arrive
+    auto Msg = Consumer->consume(ConsumeTimeoutMs);
 
     Consumer->handleMessage(Msg.get());
 
     t2 = std::chrono::high_resolution_clock::now();
     std::chrono::duration<int64_t, std::nano> elapsed = t2 - t1;
 
-    /// once every ~ 1 second, copy the histograms and tell main thread
-    /// that plots can be updated.
+    /// once every ~ 1 second tell the main thread to update the rates, the
+    /// plots pull their histogram deltas on their own timers
     if (elapsed.count() >= 1000000000LL) {
 
       int ElapsedCountMS = elapsed.count()/1000000;
@@ -6,8 +6,8 @@
 /// \brief main consumer loop for Daquiri Light (daqlite)
 /// The worker thread continuously calls ESSConsumer::consume() and
 /// ESSConsumer::handleMessage() to histogram the pixelids. Once every second
-/// the plotting thread (qt main thread?) is
-/// notified to update and plot new data.
+/// the main thread is notified to update the event rate statistics. Plots
+/// pull new data on their own schedule, see RefreshScheduler.
 //===----------------------------------------------------------------------===//
 
 #pragma once
@@ -50,11 +50,14 @@ public:
   }
 
 signals:
-  /// \brief this signal is 'emitted' when there is new data to be plotted
+  /// \brief this signal is 'emitted' when new statistics are available
   /// this is done periodically (approximately once every second)
   void resultReady(int &val);
 
 private:
+  /// \brief maximum time to block in the consumer waiting for a message
+  static constexpr int ConsumeTimeoutMs{100};
+
   /// \brief configuration obtained from main()
   Configuration &mConfig;
 
@@ -0,0 +1,178 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file HandOffBenchmark.cpp
+///
+/// \brief Contention benchmark of the worker to GUI histogram hand-off
+///
+/// A writer thread adds message sized deltas as fast as it can while reader
+/// threads take the histogram at a fixed rate, as the plots do. Reports the
+/// writer throughput and the longest writer stall, for the mutex based
+/// ThreadSafeVector and the lock-free DeltaBus. The sums are checked for
+/// every reader: the copy then clear of ThreadSafeVector loses the counts
+/// added in between and splits the rest between the readers, each reader of
+/// DeltaBus must see all counts.
+///
+/// Usage: daqlite_handoff_benchmark [cells] [seconds] [reads per second]
+///                                  [readers]
+//===----------------------------------------------------------------------===//
+
+#include <SnapshotBus.h>
+#include <ThreadSafeVector.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Result {
+  uint64_t Writes{0};
+  double MaxStallUs{0};
+  uint64_t Written{0};
+  std::vector<uint64_t> Read;
+};
+
+/// \brief adapters giving both hand-offs the same interface
+class MutexHandOff {
+public:
+  using Cursor = int;
+
+  void write(const std::vector<uint32_t> &Delta) { mBuffer.add_values(Delta); }
+
+  void flush() {}
+
+  Cursor subscribe() { return 0; }
+
+  uint64_t read(Cursor &) {
+    std::vector<uint32_t> Counts = mBuffer;
+    mBuffer.clear();
+    return std::accumulate(Counts.begin(), Counts.end(), uint64_t(0));
+  }
+
+private:
+  ThreadSafeVector<uint32_t, int64_t> mBuffer;
+};
+
+class BusHandOff {
+public:
+  using Cursor = DeltaBus<uint32_t>::Cursor;
+
+  /// \brief publishes at most every 50 ms, as the consumer does
+  void write(const std::vector<uint32_t> &Delta) {
+    mBus.add_values(Delta);
+    if (Clock::now() - mLastPublish >= std::chrono::milliseconds(50)) {
+      flush();
+    }
+  }
+
+  void flush() {
+    mBus.publish();
+    mLastPublish = Clock::now();
+  }
+
+  Cursor subscribe() { return mBus.subscribe(); }
+
+  uint64_t read(Cursor &Reader) {
+    uint64_t Sum{0};
+    for (const auto &Counts : mBus.pull(Reader)) {
+      Counts->forEach([&Sum](size_t, uint32_t Count) { Sum += Count; });
+    }
+    return Sum;
+  }
+
+private:
+  DeltaBus<uint32_t> mBus;
+  Clock::time_point mLastPublish{Clock::now()};
+};
+
+template <typename HandOffType>
+Result run(size_t Cells, double Seconds, double ReadRate, size_t Readers) {
+  HandOffType HandOff;
+  Result Res;
+  Res.Read.resize(Readers, 0);
+  std::atomic<bool> Done{false};
+
+  std::vector<typename HandOffType::Cursor> Cursors;
+  for (size_t r = 0; r < Readers; r++) {
+    Cursors.push_back(HandOff.subscribe());
+  }
+
+  std::vector<std::thread> Threads;
+  for (size_t r = 0; r < Readers; r++) {
+    Threads.emplace_back([&, r]() {
+      const auto Period = std::chrono::duration<double>(1.0 / ReadRate);
+      auto Next = Clock::now();
+      while (not Done.load()) {
+        Res.Read[r] += HandOff.read(Cursors[r]);
+        Next += std::chrono::duration_cast<Clock::duration>(Period);
+        std::this_thread::sleep_until(Next);
+      }
+    });
+  }
+
+  // A message touches a few cells of the histogram
+  std::vector<uint32_t> Delta(Cells, 0);
+  for (size_t i = 0; i < Cells; i += 97) {
+    Delta[i] = 1;
+  }
+  const uint64_t DeltaSum = std::accumulate(Delta.begin(), Delta.end(), 0ULL);
+
+  const auto End = Clock::now() + std::chrono::duration<double>(Seconds);
+  while (Clock::now() < End) {
+    auto Start = Clock::now();
+    HandOff.write(Delta);
+    double StallUs =
+        std::chrono::duration<double, std::micro>(Clock::now() - Start).count();
+    Res.MaxStallUs = std::max(Res.MaxStallUs, StallUs);
+    Res.Writes++;
+  }
+  Res.Written = Res.Writes * DeltaSum;
+
+  Done = true;
+  for (auto &Thread : Threads) {
+    Thread.join();
+  }
+
+  // The writer is idle now, take everything that is left
+  HandOff.flush();
+  for (size_t r = 0; r < Readers; r++) {
+    Res.Read[r] += HandOff.read(Cursors[r]);
+  }
+  return Res;
+}
+
+void report(const std::string &Name, const Result &Res, double Seconds) {
+  const bool Ok = std::all_of(Res.Read.begin(), Res.Read.end(),
+                              [&Res](uint64_t Read) { return Read == Res.Written; });
+  fmt::print("{:<18} {:>12.0f} writes/s  max writer stall {:>10.1f} us  {}\n",
+             Name, Res.Writes / Seconds, Res.MaxStallUs,
+             Ok ? "counts ok" : "COUNTS LOST");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  size_t Cells = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1 << 20;
+  double Seconds = (argc > 2) ? std::atof(argv[2]) : 3.0;
+  double ReadRate = (argc > 3) ? std::atof(argv[3]) : 20.0;
+  size_t Readers = (argc > 4) ? std::strtoull(argv[4], nullptr, 10) : 2;
+
+  fmt::print("{} cells, {} s, {} reads/s, {} readers\n", Cells, Seconds,
+             ReadRate, Readers);
+  report("ThreadSafeVector",
+         run<MutexHandOff>(Cells, Seconds, ReadRate, Readers), Seconds);
+  report("DeltaBus", run<BusHandOff>(Cells, Seconds, ReadRate, Readers),
+         Seconds);
+  return 0;
+}
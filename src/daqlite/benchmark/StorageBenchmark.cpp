@@ -0,0 +1,123 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file StorageBenchmark.cpp
+///
+/// \brief Fill rate and memory of the histogram cell storages
+///
+/// Fills each storage with the same events and reports the events added per
+/// second and the memory held by the counters afterwards. Detector events
+/// cluster: most of them hit a small hot region (e.g. the TOF peak of the
+/// illuminated pixels), the rest are spread over the whole histogram. The
+/// values of all cells are compared with the dense storage.
+///
+/// Usage: daqlite_storage_benchmark [cells] [events] [hot fraction of cells]
+//===----------------------------------------------------------------------===//
+
+#include <HistogramStorage.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Result {
+  double EventsPerSecond{0};
+  size_t Bytes{0};
+  bool Ok{false};
+};
+
+/// \brief memory held by the counters of each storage
+template <typename Counter> size_t bytes(const DenseStorage<Counter> &Cells) {
+  return Cells.size() * sizeof(Counter);
+}
+
+template <typename Counter>
+size_t bytes(const BlockSparseStorage<Counter> &Cells) {
+  constexpr size_t BlockCells = BlockSparseStorage<Counter>::BlockCells;
+  const size_t Blocks = Cells.dense()
+                            ? (Cells.size() + BlockCells - 1) / BlockCells
+                            : Cells.blocks();
+  return Blocks * BlockCells * sizeof(Counter);
+}
+
+template <typename Counter>
+size_t bytes(const AdaptiveStorage<Counter> &Cells) {
+  return Cells.bytes();
+}
+
+template <typename StorageType>
+Result run(size_t Cells, const std::vector<uint32_t> &Events,
+           const DenseStorage<uint64_t> &Reference) {
+  StorageType Storage;
+  Storage.resize(Cells);
+
+  auto Start = Clock::now();
+  for (uint32_t Index : Events) {
+    Storage.add(Index, 1);
+  }
+  double Seconds = std::chrono::duration<double>(Clock::now() - Start).count();
+
+  Result Res;
+  Res.EventsPerSecond = Events.size() / Seconds;
+  Res.Bytes = bytes(Storage);
+  Res.Ok = true;
+  for (size_t i = 0; i < Cells; i++) {
+    Res.Ok = Res.Ok and uint64_t(Storage.get(i)) == Reference.get(i);
+  }
+  return Res;
+}
+
+void report(const std::string &Name, const Result &Res) {
+  fmt::print("{:<28} {:>8.1f} M events/s {:>10.1f} MB  {}\n", Name,
+             Res.EventsPerSecond / 1e6, Res.Bytes / 1e6,
+             Res.Ok ? "counts ok" : "COUNTS WRONG");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  size_t Cells = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1 << 24;
+  size_t Events = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 50000000;
+  double Hot = (argc > 3) ? std::atof(argv[3]) : 0.05;
+
+  // Nine out of ten events hit the hot region in the middle
+  std::mt19937 Random(42);
+  const size_t HotCells = std::max<size_t>(1, Cells * Hot);
+  const size_t HotFirst = (Cells - HotCells) / 2;
+  std::uniform_int_distribution<size_t> InHot(HotFirst,
+                                              HotFirst + HotCells - 1);
+  std::uniform_int_distribution<size_t> Anywhere(0, Cells - 1);
+  std::uniform_int_distribution<int> Region(0, 9);
+  std::vector<uint32_t> Indices(Events);
+  for (auto &Index : Indices) {
+    Index = (Region(Random) != 0) ? InHot(Random) : Anywhere(Random);
+  }
+
+  DenseStorage<uint64_t> Reference;
+  Reference.resize(Cells);
+  for (uint32_t Index : Indices) {
+    Reference.add(Index, 1);
+  }
+
+  fmt::print("{} cells, {} events, {:.0f} % hot cells\n", Cells, Events,
+             Hot * 100);
+  report("DenseStorage<uint32_t>",
+         run<DenseStorage<uint32_t>>(Cells, Indices, Reference));
+  report("DenseStorage<uint64_t>",
+         run<DenseStorage<uint64_t>>(Cells, Indices, Reference));
+  report("BlockSparseStorage<uint32_t>",
+         run<BlockSparseStorage<uint32_t>>(Cells, Indices, Reference));
+  report("AdaptiveStorage<uint64_t>",
+         run<AdaptiveStorage<uint64_t>>(Cells, Indices, Reference));
+  return 0;
+}
@@ -21,6 +21,7 @@
 #include <fmt/format.h>
 
 #include <stdio.h>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -76,28 +77,40 @@ int main(int argc, char *argv[]) {
   main.connect(&main, &QPushButton::clicked, app.quit);
 
   // ---------------------------------------------------------------------------
-  // Get top configuration
+  // Get plot configurations, the command line overrides all of them
   const std::string FileName = CLI.value("f").toStdString();
   std::vector<Configuration> confs = Configuration::getConfigurations(FileName);
-  Configuration MainConfig = confs.front();
-  setKafkaOptions(CLI, MainConfig);
-
-  // Setup worker thread
-  std::shared_ptr<WorkerThread> Worker = std::make_shared<WorkerThread>(MainConfig);
+  for (auto &Config : confs) {
+    setKafkaOptions(CLI, Config);
+  }
+  Configuration::setViews(confs);
+
+  // Setup a worker thread per broker, consuming all topics of its plots. The
+  // first plot of a broker has the primary view of the worker
+  std::map<std::string, Configuration> MainConfigs;
+  std::map<std::string, std::shared_ptr<WorkerThread>> Workers;
+  for (const auto &Config : confs) {
+    const std::string &Broker = Config.mKafka.Broker;
+    if (Workers.count(Broker) == 0) {
+      auto &MainConfig = MainConfigs.emplace(Broker, Config).first->second;
+      Workers[Broker] = std::make_shared<WorkerThread>(MainConfig);
+    }
+  }
 
   // Setup a window for each plot
   for (size_t i=0; i < confs.size(); ++i) {
     Configuration Config = confs[i];
-    setKafkaOptions(CLI, MainConfig);
 
-    MainWindow* w = new MainWindow(Config, Worker.get());
+    MainWindow* w = new MainWindow(Config, Workers[Config.mKafka.Broker].get());
     w->setWindowTitle(QString::fromStdString(Config.mPlot.WindowTitle));
     w->setParent(&main, Qt::Window);
     w->show();
   }
 
-  // Start the worker and let the Qt event handler take over
-  Worker->start();
+  // Start the workers and let the Qt event handler take over
+  for (auto &[Broker, Worker] : Workers) {
+    Worker->start();
+  }
   // main.show();
   // main.raise();
 
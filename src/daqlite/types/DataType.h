@@ -25,12 +25,15 @@ public:
     TOF = 0x03,
     HISTOGRAM = 0x04,
     HISTOGRAM_TOF = 0x05,
-    PIXEL_ID = 0x06
+    PIXEL_ID = 0x06,
+    HISTOGRAM_TOF2D = 0x07,
+    HISTOGRAM_ROI = 0x08,
+    PULSES = 0x09
   };
 
   // Max and min enum values
   static constexpr int MIN = Types::NONE;
-  static constexpr int MAX = Types::PIXEL_ID;
+  static constexpr int MAX = Types::PULSES;
 
   // Construct from string
   DataType(const std::string &type) {
@@ -63,6 +66,18 @@ public:
       mDataType = Types::PIXEL_ID;
     }
 
+    else if (lower == "histogram_tof2d") {
+      mDataType = Types::HISTOGRAM_TOF2D;
+    }
+
+    else if (lower == "histogram_roi") {
+      mDataType = Types::HISTOGRAM_ROI;
+    }
+
+    else if (lower == "pulses") {
+      mDataType = Types::PULSES;
+    }
+
     else {
       throw std::invalid_argument("Invalid DataType string: " + type);
     }
@@ -108,6 +123,18 @@ public:
         result = "PIXEL_ID";
         break;
 
+      case Types::HISTOGRAM_TOF2D:
+        result = "HISTOGRAM_TOF2D";
+        break;
+
+      case Types::HISTOGRAM_ROI:
+        result = "HISTOGRAM_ROI";
+        break;
+
+      case Types::PULSES:
+        result = "PULSES";
+        break;
+
       default:
         break;
     }
@@ -122,7 +149,10 @@ public:
       Types::TOF,
       Types::HISTOGRAM,
       Types::HISTOGRAM_TOF,
-      Types::PIXEL_ID
+      Types::PIXEL_ID,
+      Types::HISTOGRAM_TOF2D,
+      Types::HISTOGRAM_ROI,
+      Types::PULSES
     };
   }
 